@@ -24,18 +24,693 @@
 //
 #pragma once
 
-#include <format>
+#include <bit>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <array>
+#include <tuple>
 #include <string>
 #include <vector>
+#include <cmath>
+#include <cerrno>
 #include <cstdint>
+#include <cstring>
+#include <charconv>
 #include <utility>
 #include <algorithm>
+#include <numeric>
 #include <string_view>
 #include <type_traits>
+#include <stdexcept>
+#include <functional>
 #include <forward_list>
+#include <unordered_map>
+#include <memory_resource>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <system_error>
+#include <exception>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#if !defined(JXXSON_DISABLE_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#   define JXXSON_X86_SIMD 1
+#   include <immintrin.h>
+#   if defined(_MSC_VER) && !defined(__clang__)
+#       include <intrin.h>
+#   endif
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#   define JXXSON_POSIX_MMAP 1
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#   define JXXSON_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#   define JXXSON_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
 
 namespace jxxson {
+    // Character scanners for contiguous input, they are the hot loops of the parser.
+    // On x86-64 blocks of 64 bytes are classified at once with SSE2 (always available) or AVX2 (checked at runtime),
+    // other platforms and constant evaluation use the scalar version.
+    namespace detail {
+        struct scan_kernels {
+            const char* (*skip_spaces)(const char*, const char*);      // First byte that is not ' ', '\n', '\r' or '\t'.
+            const char* (*find_string_end)(const char*, const char*);  // First '\"' or '\\'.
+            const char* (*find_structural)(const char*, const char*);  // First '\"', '{', '}', '[' or ']'.
+            const char* (*find_non_ascii)(const char*, const char*);   // First byte >= 0x80.
+        };
+
+        constexpr bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+        constexpr const char* skip_spaces_scalar(const char* beg, const char* end) {
+            for (;beg != end && is_space(*beg); ++beg) {}
+            return beg;
+        }
+
+        constexpr const char* find_string_end_scalar(const char* beg, const char* end) {
+            for (;beg != end && *beg != '\"' && *beg != '\\'; ++beg) {}
+            return beg;
+        }
+
+        constexpr const char* find_structural_scalar(const char* beg, const char* end) {
+            for (;beg != end && *beg != '\"' && *beg != '{' && *beg != '}' && *beg != '[' && *beg != ']'; ++beg) {}
+            return beg;
+        }
+
+        constexpr bool needs_escape(char c) { return c == '\"' || c == '\\' || static_cast<unsigned char>(c) < 0x20; }
+
+        constexpr const char* find_escape_scalar(const char* beg, const char* end) {
+            for (;beg != end && !needs_escape(*beg); ++beg) {}
+            return beg;
+        }
+
+        constexpr const char* find_non_ascii_scalar(const char* beg, const char* end) {
+            for (;beg != end && static_cast<unsigned char>(*beg) < 0x80; ++beg) {}
+            return beg;
+        }
+
+#if defined(JXXSON_X86_SIMD)
+        inline std::uint64_t space_mask_sse2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 4; ++i) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+                const __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),  _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+                                               _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(m))) << (16 * i);
+            }
+            return mask;
+        }
+
+        inline std::uint64_t string_end_mask_sse2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 4; ++i) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+                const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(m))) << (16 * i);
+            }
+            return mask;
+        }
+
+        // '{' | 0x20 is '{' and '[' | 0x20 is '{', so two compares find all four brackets.
+        inline std::uint64_t structural_mask_sse2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 4; ++i) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+                const __m128i l = _mm_or_si128(v, _mm_set1_epi8(0x20));
+                const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')),
+                                               _mm_or_si128(_mm_cmpeq_epi8(l, _mm_set1_epi8('{')), _mm_cmpeq_epi8(l, _mm_set1_epi8('}'))));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(m))) << (16 * i);
+            }
+            return mask;
+        }
+
+        inline std::uint64_t non_ascii_mask_sse2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 4; ++i) {
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i))))) << (16 * i);
+            }
+            return mask;
+        }
+
+#   if defined(__GNUC__) || defined(__clang__)
+#       define JXXSON_TARGET_AVX2 __attribute__((target("avx2")))
+#   else
+#       define JXXSON_TARGET_AVX2
+#   endif
+        JXXSON_TARGET_AVX2 inline std::uint64_t space_mask_avx2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 2; ++i) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+                const __m256i m = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),  _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << (32 * i);
+            }
+            return mask;
+        }
+
+        JXXSON_TARGET_AVX2 inline std::uint64_t string_end_mask_avx2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 2; ++i) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+                const __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << (32 * i);
+            }
+            return mask;
+        }
+
+        JXXSON_TARGET_AVX2 inline std::uint64_t structural_mask_avx2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 2; ++i) {
+                const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+                const __m256i l = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+                const __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"')),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(l, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(l, _mm256_set1_epi8('}'))));
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m))) << (32 * i);
+            }
+            return mask;
+        }
+
+        JXXSON_TARGET_AVX2 inline std::uint64_t non_ascii_mask_avx2(const char* p) {
+            std::uint64_t mask = 0;
+            for (int i = 0; i != 2; ++i) {
+                mask |= static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i))))) << (32 * i);
+            }
+            return mask;
+        }
+
+        // Whitespace runs between tokens are usually short, so the first byte is checked before a block is loaded.
+        template <std::uint64_t (*SpaceMask)(const char*)>
+        inline const char* skip_spaces_block(const char* beg, const char* end) {
+            if (beg == end || !is_space(*beg)) { return beg; }
+            for (;end - beg >= 64; beg += 64) {
+                if (const std::uint64_t m = ~SpaceMask(beg); m != 0) { return beg + std::countr_zero(m); }
+            }
+            return skip_spaces_scalar(beg, end);
+        }
+
+        template <std::uint64_t (*Mask)(const char*), const char* (*Scalar)(const char*, const char*)>
+        inline const char* find_first_block(const char* beg, const char* end) {
+            for (;end - beg >= 64; beg += 64) {
+                if (const std::uint64_t m = Mask(beg); m != 0) { return beg + std::countr_zero(m); }
+            }
+            return Scalar(beg, end);
+        }
+
+        JXXSON_TARGET_AVX2 inline const char* skip_spaces_avx2(const char* beg, const char* end)     { return skip_spaces_block<space_mask_avx2>(beg, end); }
+        JXXSON_TARGET_AVX2 inline const char* find_string_end_avx2(const char* beg, const char* end) { return find_first_block<string_end_mask_avx2, find_string_end_scalar>(beg, end); }
+        JXXSON_TARGET_AVX2 inline const char* find_structural_avx2(const char* beg, const char* end) { return find_first_block<structural_mask_avx2, find_structural_scalar>(beg, end); }
+        JXXSON_TARGET_AVX2 inline const char* find_non_ascii_avx2(const char* beg, const char* end)  { return find_first_block<non_ascii_mask_avx2, find_non_ascii_scalar>(beg, end); }
+
+        inline bool cpu_supports_avx2() {
+#   if defined(__GNUC__) || defined(__clang__)
+            return __builtin_cpu_supports("avx2");
+#   else
+            int info[4]; __cpuid(info, 0);
+            if (info[0] < 7) { return false; }
+            __cpuid(info, 1);
+            const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+            __cpuidex(info, 7, 0);
+            return os_saves_ymm && (info[1] & (1 << 5));
+#   endif
+        }
+#endif
+
+        inline const scan_kernels& scanner() {
+            static const scan_kernels kernels = [] {
+#if defined(JXXSON_X86_SIMD)
+                if (cpu_supports_avx2()) { return scan_kernels{skip_spaces_avx2, find_string_end_avx2, find_structural_avx2, find_non_ascii_avx2}; }
+                return scan_kernels{skip_spaces_block<space_mask_sse2>, find_first_block<string_end_mask_sse2, find_string_end_scalar>,
+                                    find_first_block<structural_mask_sse2, find_structural_scalar>, find_first_block<non_ascii_mask_sse2, find_non_ascii_scalar>};
+#else
+                return scan_kernels{skip_spaces_scalar, find_string_end_scalar, find_structural_scalar, find_non_ascii_scalar};
+#endif
+            }();
+            return kernels;
+        }
+
+        // Function pointers are fetched once per parse, constant evaluation can only call the scalar kernels.
+        constexpr scan_kernels select_scanner() {
+            if (std::is_constant_evaluated()) { return scan_kernels{skip_spaces_scalar, find_string_end_scalar, find_structural_scalar, find_non_ascii_scalar}; }
+            return scanner();
+        }
+
+        // Strings handed to the formatter are mostly short, so they are scanned in 16 byte steps with SSE2 (always there
+        // on x86-64, no dispatch). The last step overlaps the one before it instead of ending in a byte loop, the bytes
+        // seen twice are known not to match. There is no unsigned byte compare, but min(v, 0x1F) == v holds exactly
+        // for control characters.
+#if defined(JXXSON_X86_SIMD)
+        inline unsigned escape_mask16(const char* p) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                           _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v));
+            return static_cast<unsigned>(_mm_movemask_epi8(m));
+        }
+#endif
+
+        // Same test on 8 bytes of a little endian register, a borrow only runs upwards from a byte that matched
+        // so the lowest flagged byte is a real match. Returns 8 if no byte needs an escape.
+        inline int escape_index8(const char* p) {
+            constexpr std::uint64_t ones = 0x0101010101010101, high = 0x8080808080808080;
+            std::uint64_t x; std::memcpy(&x, p, 8);
+            const std::uint64_t quote = x ^ (ones * '\"'), slash = x ^ (ones * '\\');
+            return std::countr_zero((((quote - ones) & ~quote) | ((slash - ones) & ~slash) | ((x - ones * 0x20) & ~x)) & high) / 8;
+        }
+
+        inline const char* find_escape_fast(const char* beg, const char* end) {
+#if defined(JXXSON_X86_SIMD)
+            if (end - beg >= 16) {
+                for (;end - beg > 16; beg += 16) {
+                    if (const unsigned m = escape_mask16(beg); m != 0) { return beg + std::countr_zero(m); }
+                }
+                const unsigned m = escape_mask16(end - 16);
+                return m != 0 ? end - 16 + std::countr_zero(m) : end;
+            }
+#endif
+            if constexpr (std::endian::native == std::endian::little) {
+                if (end - beg >= 8) {
+                    for (;end - beg > 8; beg += 8) {
+                        if (const int i = escape_index8(beg); i != 8) { return beg + i; }
+                    }
+                    const int i = escape_index8(end - 8);
+                    return i != 8 ? end - 8 + i : end;
+                }
+            }
+            return find_escape_scalar(beg, end);
+        }
+
+        constexpr bool is_number_char(char c) {
+            return (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+        }
+
+        // Token helpers shared by every parser working on contiguous narrow input.
+        // Returns position of the closing quote (or end), beg must point just after the opening quote.
+        constexpr const char* find_string_close(const scan_kernels& scan, const char* beg, const char* end, bool& escaped) {
+            const char* it = scan.find_string_end(beg, end);
+            for (;it != end && *it == '\\'; it = scan.find_string_end(it + std::min<std::ptrdiff_t>(2, end - it), end)) { escaped = true; }
+            return it;
+        }
+
+        // End of the characters a number can be made of, used to find numbers cut by the end of a chunk.
+        constexpr const char* find_number_end(const char* beg, const char* end) {
+            for (;beg != end && is_number_char(*beg); ++beg) {}
+            return beg;
+        }
+
+        // Past the bracket that closes the container opening at beg, nullptr if the brackets of input do not balance.
+        // Only brackets and strings are followed, the values in between are not checked.
+        constexpr const char* find_container_end(const scan_kernels& scan, const char* beg, const char* end) {
+            std::size_t depth = 0;
+            for (const char* it = beg; (it = scan.find_structural(it, end)) != end;) {
+                if (*it == '\"') {
+                    bool escaped = false;
+                    if ((it = find_string_close(scan, it + 1, end, escaped)) == end) { break; }
+                } else if (*it == '{' || *it == '[') { ++depth; }
+                else if (--depth == 0) { return it + 1; }
+                ++it;
+            }
+            return nullptr;
+        }
+
+        constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+        // Eight ASCII digits read as one little endian word are checked and converted without a loop,
+        // the multiplications combine neighbouring digits into pairs, then pairs into quads, then both halves.
+        constexpr bool is_eight_digits(std::uint64_t v) {
+            return ((v & 0xF0F0F0F0F0F0F0F0) | (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+        }
+
+        constexpr std::uint32_t eight_digits_value(std::uint64_t v) {
+            v -= 0x3030303030303030;
+            v  = (v * 10) + (v >> 8);
+            v  = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) + (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+            return static_cast<std::uint32_t>(v);
+        }
+
+        // Appends the digits at it to value (it wraps after 19 digits, callers check the count), returns the first non digit.
+        constexpr const char* read_digits(const char* it, const char* end, std::uint64_t& value) {
+            if (!std::is_constant_evaluated() && std::endian::native == std::endian::little) {
+                for (;end - it >= 8; it += 8) {
+                    std::uint64_t word; std::memcpy(&word, it, 8);
+                    if (!is_eight_digits(word)) { break; }
+                    value = value * 100000000 + eight_digits_value(word);
+                }
+            }
+            for (;it != end && is_digit(*it); ++it) { value = value * 10 + static_cast<std::uint64_t>(*it - '0'); }
+            return it;
+        }
+
+        // Powers of ten a float type holds exactly, with the largest mantissa it holds exactly. A mantissa and
+        // a power both within these limits give a correctly rounded result with one multiplication or division (Clinger).
+        template <class FloatingPoint>
+        struct exact_powers { static constexpr int max_exponent = -1; };
+
+        template <>
+        struct exact_powers<float> {
+            static constexpr int           max_exponent = 10;
+            static constexpr std::uint64_t max_mantissa = std::uint64_t{1} << 24;
+            static constexpr float         powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        };
+
+        template <>
+        struct exact_powers<double> {
+            static constexpr int           max_exponent = 22;
+            static constexpr std::uint64_t max_mantissa = std::uint64_t{1} << 53;
+            static constexpr double        powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+        };
+
+        // literal is set for numbers neither type holds, integers beyond Integer and magnitudes FloatingPoint cannot
+        // reach. f is then only the closest float (infinity or zero out of range) and callers keep the text instead.
+        template <class Integer, class FloatingPoint>
+        struct number_value {
+            bool          is_float = false;
+            bool          literal  = false;
+            Integer       i{};
+            FloatingPoint f{};
+        };
+
+        // Parses the json number at beg straight from the input and returns its end, or nullptr if the text breaks the
+        // grammar (leading zeros, a lone '-', '.' or exponent without digits). Integers that do not fit Integer are
+        // stored as FloatingPoint and marked literal. Floats beyond the exact fast path and literals with more than
+        // 19 significant digits go to std::from_chars.
+        template <class Integer, class FloatingPoint>
+        constexpr const char* parse_number(const char* beg, const char* end, number_value<Integer, FloatingPoint>& out) {
+            const char*   it       = beg;
+            const bool    negative = it != end && *it == '-';
+            std::uint64_t mantissa = 0;
+            std::int64_t  exponent = 0;
+            bool          is_float = false;
+            if (negative) { ++it; }
+            const char* digits = it;
+            if (it == end || !is_digit(*it)) { return nullptr; }
+            if (*it == '0') { if (++it != end && is_digit(*it)) { return nullptr; } }
+            else { it = read_digits(it, end, mantissa); }
+            std::ptrdiff_t count = it - digits;
+            if (it != end && *it == '.') {
+                const char* fraction = ++it;
+                it = read_digits(it, end, mantissa);
+                if (it == fraction) { return nullptr; }
+                exponent = fraction - it;
+                count   += it - fraction;
+                is_float = true;
+            }
+            if (it != end && (*it == 'e' || *it == 'E')) {
+                const bool negative_exponent = ++it != end && *it == '-';
+                if (it != end && (*it == '+' || *it == '-')) { ++it; }
+                if (it == end || !is_digit(*it)) { return nullptr; }
+                std::int64_t e = 0;
+                for (;it != end && is_digit(*it); ++it) { if (e < 1000000) { e = e * 10 + (*it - '0'); } }
+                exponent += negative_exponent ? -e : e;
+                is_float  = true;
+            }
+            // Leading zeros of 0.000123 do not count, they are only skipped when the count is close.
+            if (count > 19) {
+                for (const char* d = digits; d != it && (*d == '0' || *d == '.'); ++d) { count -= *d == '0'; }
+            }
+            bool exact = count <= 19;
+            // 20 digits overflow the digit loop but still fit an uint64 up to 18446744073709551615.
+            if (!is_float && count == 20 && std::from_chars(digits, it, mantissa).ec == std::errc{}) { exact = true; }
+
+            out.literal = false;
+            if (!is_float && exact) {
+                using limits = std::numeric_limits<Integer>;
+                const std::uint64_t limit = static_cast<std::uint64_t>(limits::max()) + (negative && limits::is_signed ? 1 : 0);
+                if (mantissa <= limit && (limits::is_signed || !negative || mantissa == 0)) {
+                    out.is_float = false;
+                    out.i        = negative ? static_cast<Integer>(0 - mantissa) : static_cast<Integer>(mantissa);
+                    return it;
+                }
+            }
+            out.is_float = true;
+            out.literal  = !is_float;
+            if constexpr (exact_powers<FloatingPoint>::max_exponent > 0) {
+                using powers = exact_powers<FloatingPoint>;
+                if (exact && mantissa <= powers::max_mantissa && exponent >= -powers::max_exponent && exponent <= powers::max_exponent) {
+                    FloatingPoint f = static_cast<FloatingPoint>(mantissa);
+                    f = exponent < 0 ? f / powers::powers[-exponent] : f * powers::powers[exponent];
+                    out.f = negative ? -f : f;
+                    return it;
+                }
+            }
+            FloatingPoint f{};
+            if (std::from_chars(beg, it, f, std::chars_format::general).ec == std::errc::result_out_of_range) {
+                f = exponent > 0 ? std::numeric_limits<FloatingPoint>::infinity() : FloatingPoint{0};
+                if (negative) { f = -f; }
+                out.literal = true;
+            }
+            out.f = f;
+            return it;
+        }
+
+        // Closest FloatingPoint of a number kept as its text.
+        template <class FloatingPoint, class CharT>
+        constexpr FloatingPoint literal_value(std::basic_string_view<CharT> text) {
+            number_value<long long, FloatingPoint> num;
+            if constexpr (std::is_same_v<CharT, char>) { parse_number(text.data(), text.data() + text.size(), num); }
+            else { const std::string narrow(text.begin(), text.end()); parse_number(narrow.data(), narrow.data() + narrow.size(), num); }
+            return num.is_float ? num.f : static_cast<FloatingPoint>(num.i);
+        }
+
+        // Reads an array whose elements are all integers or all floats, beg is just past its '['. Returns the end of the array
+        // with the elements in ints or floats, nullptr if the array is empty or holds anything else (the vectors are then garbage).
+        template <class Ints, class Floats>
+        constexpr const char* parse_packed_array(const scan_kernels& scan, const char* beg, const char* end, Ints& ints, Floats& floats) {
+            number_value<typename Ints::value_type, typename Floats::value_type> num;
+            auto skip = [&](const char* p) { return p != end && is_space(*p) ? scan.skip_spaces(p, end) : p; };
+            ints.clear(); floats.clear();
+            for (;;) {
+                beg = skip(beg);
+                if (beg == end || (*beg != '-' && !is_digit(*beg))) { return nullptr; }
+                if ((beg = parse_number(beg, end, num)) == nullptr || num.literal) { return nullptr; }
+                if (num.is_float) { floats.push_back(num.f); } else { ints.push_back(num.i); }
+                if (!ints.empty() && !floats.empty()) { return nullptr; }
+                beg = skip(beg);
+                if (beg == end) { return nullptr; }
+                if (*beg == ']') { return beg + 1; }
+                if (*beg++ != ',') { return nullptr; }
+            }
+        }
+
+        constexpr bool match_literal(const char* beg, const char* end, std::string_view literal) {
+            return static_cast<std::size_t>(end - beg) >= literal.size() && std::string_view(beg, literal.size()) == literal;
+        }
+
+        template <class CharT>
+        constexpr int hex_digit(CharT c) {
+            if (c >= CharT{'0'} && c <= CharT{'9'}) { return static_cast<int>(c - CharT{'0'}); }
+            if (c >= CharT{'a'} && c <= CharT{'f'}) { return static_cast<int>(c - CharT{'a'}) + 10; }
+            if (c >= CharT{'A'} && c <= CharT{'F'}) { return static_cast<int>(c - CharT{'A'}) + 10; }
+            return -1;
+        }
+
+        template <class CharT>
+        constexpr long parse_hex4(const CharT* beg, const CharT* end) {
+            if (end - beg < 4) { return -1; }
+            long v = 0;
+            for (int i = 0; i != 4; ++i) {
+                const int d = hex_digit(beg[i]);
+                if (d < 0) { return -1; }
+                v = (v << 4) | d;
+            }
+            return v;
+        }
+
+        template <class String>
+        constexpr void append_utf8(String& out, std::uint32_t cp) {
+            using ch = typename String::value_type;
+            if (cp < 0x80)         { out.push_back(static_cast<ch>(cp)); }
+            else if (cp < 0x800)   { out.push_back(static_cast<ch>(0xC0 | (cp >> 6)));  out.push_back(static_cast<ch>(0x80 | (cp & 0x3F))); }
+            else if (cp < 0x10000) { out.push_back(static_cast<ch>(0xE0 | (cp >> 12))); out.push_back(static_cast<ch>(0x80 | ((cp >> 6) & 0x3F))); out.push_back(static_cast<ch>(0x80 | (cp & 0x3F))); }
+            else {
+                out.push_back(static_cast<ch>(0xF0 | (cp >> 18)));         out.push_back(static_cast<ch>(0x80 | ((cp >> 12) & 0x3F)));
+                out.push_back(static_cast<ch>(0x80 | ((cp >> 6) & 0x3F))); out.push_back(static_cast<ch>(0x80 | (cp & 0x3F)));
+            }
+        }
+
+        // UTF-8 for narrow strings, UTF-16 for 16 bit characters and the code point itself for wider ones.
+        template <class String>
+        constexpr void append_code_point(String& out, std::uint32_t cp) {
+            using ch = typename String::value_type;
+            if constexpr (sizeof(ch) == 1) { append_utf8(out, cp); }
+            else if constexpr (sizeof(ch) == 2) {
+                if (cp < 0x10000) { out.push_back(static_cast<ch>(cp)); }
+                else { out.push_back(static_cast<ch>(0xD800 + ((cp - 0x10000) >> 10))); out.push_back(static_cast<ch>(0xDC00 + (cp & 0x3FF))); }
+            } else { out.push_back(static_cast<ch>(cp)); }
+        }
+
+        // Decodes a raw json string (without quotes), runs without escapes are appended as a whole.
+        // Unknown or broken escapes are kept as they are, a surrogate without its other half becomes U+FFFD.
+        template <class String, class CharT>
+        constexpr void unescape_to(String& out, const CharT* beg, const CharT* end) {
+            while (beg != end) {
+                const CharT* run = std::char_traits<CharT>::find(beg, static_cast<std::size_t>(end - beg), CharT{'\\'});
+                if (run == nullptr) { run = end; }
+                out.append(beg, run);
+                if (run == end) { break; }
+                if (end - run < 2) { out.push_back(*run); break; }
+                beg = run + 2;
+                switch (run[1]) {
+                default:  out.append(run, beg); break;
+                case CharT{'\"'}: case CharT{'\\'}: case CharT{'/'}: out.push_back(run[1]); break;
+                case CharT{'b'}: out.push_back(CharT{'\b'}); break;
+                case CharT{'f'}: out.push_back(CharT{'\f'}); break;
+                case CharT{'n'}: out.push_back(CharT{'\n'}); break;
+                case CharT{'r'}: out.push_back(CharT{'\r'}); break;
+                case CharT{'t'}: out.push_back(CharT{'\t'}); break;
+                case CharT{'u'}: {
+                    long cp = parse_hex4(beg, end);
+                    if (cp < 0) { out.append(run, beg); break; }
+                    beg += 4;
+                    if (cp >= 0xD800 && cp < 0xE000) {
+                        const long low = cp < 0xDC00 && end - beg >= 6 && beg[0] == CharT{'\\'} && beg[1] == CharT{'u'} ? parse_hex4(beg + 2, end) : -1;
+                        if (low >= 0xDC00 && low < 0xE000) { cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00); beg += 6; }
+                        else { cp = 0xFFFD; }
+                    }
+                    append_code_point(out, static_cast<std::uint32_t>(cp));
+                } break;
+                }
+            }
+        }
+
+        // Offset of the first byte that does not belong to a well formed UTF-8 sequence (no overlong forms,
+        // surrogates or code points above U+10FFFF), or end. ASCII runs are skipped by the block scanner.
+        constexpr const char* find_invalid_utf8(const scan_kernels& scan, const char* beg, const char* end) {
+            for (;;) {
+                beg = scan.find_non_ascii(beg, end);
+                if (beg == end) { return end; }
+                const auto     lead = static_cast<unsigned char>(*beg);
+                std::ptrdiff_t tail = 0;
+                unsigned char  lo = 0x80, hi = 0xBF;
+                if (lead >= 0xC2 && lead <= 0xDF)      { tail = 1; }
+                else if (lead >= 0xE0 && lead <= 0xEF) { tail = 2; lo = lead == 0xE0 ? 0xA0 : 0x80; hi = lead == 0xED ? 0x9F : 0xBF; }
+                else if (lead >= 0xF0 && lead <= 0xF4) { tail = 3; lo = lead == 0xF0 ? 0x90 : 0x80; hi = lead == 0xF4 ? 0x8F : 0xBF; }
+                else { return beg; }
+                if (end - beg <= tail) { return beg; }
+                if (const auto c = static_cast<unsigned char>(beg[1]); c < lo || c > hi) { return beg; }
+                for (std::ptrdiff_t i = 2; i <= tail; ++i) {
+                    if ((static_cast<unsigned char>(beg[i]) & 0xC0) != 0x80) { return beg; }
+                }
+                beg += tail + 1;
+            }
+        }
+
+        // Output of formatters is collected here and handed to Flush in blocks, instead of one character at a time.
+        template <class CharT, class Flush, std::size_t Capacity = 4096 / sizeof(CharT)>
+        class format_sink {
+            CharT       buf_[Capacity]{};
+            std::size_t used_ = 0;
+        public:
+            using char_type = CharT;
+
+            Flush flush_to;
+
+            constexpr explicit format_sink(Flush flush) : flush_to(std::move(flush)) {}
+
+            constexpr void put(CharT c) {
+                if (used_ == Capacity) { flush(); }
+                buf_[used_++] = c;
+            }
+
+            constexpr void write(const CharT* p, std::size_t n) {
+                if (n > Capacity - used_) {
+                    flush();
+                    if (n > Capacity) { flush_to(p, n); return; }
+                }
+                std::copy_n(p, n, buf_ + used_); used_ += n;
+            }
+
+            constexpr void write(std::basic_string_view<CharT> str) { write(str.data(), str.size()); }
+
+            constexpr void fill(std::size_t n, CharT c) {
+                while (n != 0) {
+                    if (used_ == Capacity) { flush(); }
+                    const std::size_t k = std::min(n, Capacity - used_);
+                    std::fill_n(buf_ + used_, k, c); used_ += k; n -= k;
+                }
+            }
+
+            constexpr void flush() {
+                if (used_ != 0) { flush_to(buf_, used_); used_ = 0; }
+            }
+        };
+
+        template <class CharT, class OutputIt>
+        struct iterator_flush {
+            OutputIt out;
+            constexpr void operator()(const CharT* p, std::size_t n) { out = std::ranges::copy(p, p + n, out).out; }
+        };
+
+        // Writes a string with json escapes, runs without special characters are copied as a whole.
+        template <class CharT, class Sink>
+        constexpr void escape_to(std::basic_string_view<CharT> str, Sink& sink) {
+            constexpr CharT hex[] = {CharT{'0'}, CharT{'1'}, CharT{'2'}, CharT{'3'}, CharT{'4'}, CharT{'5'}, CharT{'6'}, CharT{'7'},
+                                     CharT{'8'}, CharT{'9'}, CharT{'a'}, CharT{'b'}, CharT{'c'}, CharT{'d'}, CharT{'e'}, CharT{'f'}};
+            const CharT* beg = str.data();
+            const CharT* end = str.data() + str.size();
+            const auto   next_escape = [end](const CharT* it) {
+                if constexpr (std::is_same_v<CharT, char>) { return std::is_constant_evaluated() ? find_escape_scalar(it, end) : find_escape_fast(it, end); }
+                else { return std::find_if(it, end, [](CharT c) { return c == CharT{'\"'} || c == CharT{'\\'} || (c >= CharT{0} && c < CharT{0x20}); }); }
+            };
+            while (beg != end) {
+                const CharT* run = next_escape(beg);
+                sink.write(beg, static_cast<std::size_t>(run - beg));
+                if (run == end) { break; }
+                sink.put(CharT{'\\'});
+                switch (*run) {
+                case CharT{'\"'}:  sink.put(CharT{'\"'});  break;
+                case CharT{'\\'}: sink.put(CharT{'\\'}); break;
+                case CharT{'\b'}: sink.put(CharT{'b'}); break;
+                case CharT{'\f'}: sink.put(CharT{'f'}); break;
+                case CharT{'\n'}: sink.put(CharT{'n'}); break;
+                case CharT{'\r'}: sink.put(CharT{'r'}); break;
+                case CharT{'\t'}: sink.put(CharT{'t'}); break;
+                default: {
+                    const CharT u[] = {CharT{'u'}, CharT{'0'}, CharT{'0'}, hex[(*run >> 4) & 0xF], hex[*run & 0xF]};
+                    sink.write(u, 5);
+                } break;
+                }
+                beg = run + 1;
+            }
+        }
+
+        // Shortest text that reads back to the same number. Floats always keep a '.' or an exponent
+        // so they are parsed back as floats, JSON has no infinities or NaN so those become null.
+        template <class Number, class Sink>
+        constexpr void write_number(Number n, Sink& sink) {
+            using char_type = typename Sink::char_type;
+            char  buf[64];
+            char* last = buf;
+            if constexpr (std::is_floating_point_v<Number>) {
+                if (!std::isfinite(n)) { last = std::ranges::copy(std::string_view("null"), buf).out; }
+                else {
+                    last = std::to_chars(buf, buf + sizeof(buf), n).ptr;
+                    if (std::find_if(buf, last, [](char c) { return c == '.' || c == 'e'; }) == last) { *last++ = '.'; *last++ = '0'; }
+                }
+            } else { last = std::to_chars(buf, buf + sizeof(buf), n).ptr; }
+            if constexpr (std::is_same_v<char_type, char>) { sink.write(buf, static_cast<std::size_t>(last - buf)); }
+            else { for (const char* p = buf; p != last; ++p) { sink.put(static_cast<char_type>(*p)); } }
+        }
+    }
+
+    // Offset of the first byte of text that is not well formed UTF-8, text.size() if every byte is.
+    constexpr std::size_t find_invalid_utf8(std::string_view text) {
+        return static_cast<std::size_t>(detail::find_invalid_utf8(detail::select_scanner(), text.data(), text.data() + text.size()) - text.data());
+    }
+
+
     enum class document_tree_node_type : std::uint8_t {
         null,
         boolean,
@@ -47,94 +722,357 @@ namespace jxxson {
         root
     };
 
+    // Pretty output puts every value on its own line, indented by indent spaces per level,
+    // minified output has no whitespace at all.
+    struct format_style {
+        bool        pretty = true;
+        std::size_t indent = 2;
+    };
+
+    inline constexpr format_style format_pretty   = {true,  2};
+    inline constexpr format_style format_minified = {false, 0};
+
+    namespace detail {
+        // Value writer shared by all value types.
+        template <bool IsBegin, class Value, class Sink>
+        constexpr void write_value(const Value& v, Sink& sink) {
+            using char_type   = typename Sink::char_type;
+            using string_view = std::basic_string_view<char_type>;
+            constexpr char_type  out_null [4]  = {char_type{'n'}, char_type{'u'}, char_type{'l'}, char_type{'l'}};
+            constexpr char_type  out_true [4]  = {char_type{'t'}, char_type{'r'}, char_type{'u'}, char_type{'e'}};
+            constexpr char_type  out_false[5]  = {char_type{'f'}, char_type{'a'}, char_type{'l'}, char_type{'s'}, char_type{'e'}};
+            if constexpr (IsBegin) {
+                switch (v.type) {
+                case document_tree_node_type::null:           sink.write(out_null, 4); break;
+                case document_tree_node_type::boolean:        v.template as<bool>() ? sink.write(out_true, 4) : sink.write(out_false, 5); break;
+                case document_tree_node_type::integer:        write_number(v.template as<typename Value::int_type>(), sink); break;
+                case document_tree_node_type::floating_point:
+                    if (v.literal()) { const string_view text = v.literal_text(); sink.write(text.data(), text.size()); }
+                    else { write_number(v.template as<typename Value::float_type>(), sink); }
+                    break;
+                case document_tree_node_type::string: {
+                    sink.put(char_type{'\"'});
+                    escape_to(v.template as<string_view>(), sink);
+                    sink.put(char_type{'\"'});
+                } break;
+                case document_tree_node_type::object: sink.put(char_type{'{'}); break;
+                case document_tree_node_type::array:  sink.put(char_type{'['}); break;
+                case document_tree_node_type::root: break;
+                }
+            } else {
+                switch (v.type) {
+                default: break;
+                case document_tree_node_type::object: sink.put(char_type{'}'}); break;
+                case document_tree_node_type::array:  sink.put(char_type{']'}); break;
+                }
+            }
+        }
+    }
+
     static constexpr struct document_node_root_tag_type   { std::size_t padding; } document_node_root_tag{};
     static constexpr struct document_node_array_tag_type  { std::size_t padding; } document_node_array_tag{};
     static constexpr struct document_node_object_tag_type { std::size_t padding; } document_node_object_tag{};
+    static constexpr struct document_node_number_tag_type { std::size_t padding; } document_node_number_tag{};
+
+    // Compact owning string used for node names and string values, 16 bytes with std::allocator.
+    // Short strings (12 narrow characters) are stored inline, longer ones in an exactly sized heap block.
+    template <class CharT = char, class Allocator = std::allocator<CharT>>
+    class document_string {
+    public:
+        using value_type          = CharT;
+        using allocator_type      = Allocator;
+        using size_type           = std::size_t;
+        using string_view         = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using const_iterator      = const CharT*;
+
+        static constexpr size_type inline_capacity = 12 / sizeof(CharT);
+    private:
+        using traits = std::allocator_traits<Allocator>;
+
+        // Both representations start with size, so it can be read through either of them.
+        struct heap_rep  { std::uint32_t size; std::uint32_t capacity; CharT* ptr; };
+        struct small_rep { std::uint32_t size; CharT buf[inline_capacity]; };
+        union {
+            heap_rep  heap_;
+            small_rep small_;
+        };
+        JXXSON_NO_UNIQUE_ADDRESS Allocator alloc_;
+
+        constexpr bool is_small() const noexcept { return small_.size <= inline_capacity; }
+
+        constexpr void release() noexcept {
+            if (!is_small()) { traits::deallocate(alloc_, heap_.ptr, heap_.capacity); }
+            small_ = small_rep{};
+        }
+
+        constexpr void steal(document_string& right) noexcept {
+            if (right.is_small()) { small_ = right.small_; }
+            else { heap_ = right.heap_; }
+            right.small_ = small_rep{};
+        }
+    public:
+        constexpr document_string(const Allocator& a = Allocator{}) noexcept : small_(), alloc_(a) {}
+        constexpr explicit document_string(string_view s, const Allocator& a = Allocator{}) : small_(), alloc_(a) { assign(s); }
+        constexpr explicit document_string(const CharT* s, const Allocator& a = Allocator{}) : small_(), alloc_(a) { assign(s); }
+        constexpr document_string(const document_string& right)
+            : small_(), alloc_(traits::select_on_container_copy_construction(right.alloc_)) { assign(right.view()); }
+        constexpr document_string(const document_string& right, const Allocator& a) : small_(), alloc_(a) { assign(right.view()); }
+        constexpr document_string(document_string&& right) noexcept : small_(), alloc_(right.alloc_) { steal(right); }
+        constexpr document_string(document_string&& right, const Allocator& a) noexcept(traits::is_always_equal::value) : small_(), alloc_(a) {
+            if (alloc_ == right.alloc_) { steal(right); }
+            else { assign(right.view()); }
+        }
+        constexpr ~document_string() { release(); }
+
+        constexpr document_string& operator=(const document_string& right) {
+            if (this != &right) { assign(right.view()); }
+            return *this;
+        }
+
+        constexpr document_string& operator=(document_string&& right) noexcept(traits::is_always_equal::value) {
+            if (this == &right) { return *this; }
+            if constexpr (traits::propagate_on_container_move_assignment::value) {
+                release(); alloc_ = right.alloc_; steal(right);
+            } else if (alloc_ == right.alloc_) {
+                release(); steal(right);
+            } else { assign(right.view()); }
+            return *this;
+        }
+
+        constexpr document_string& operator=(string_view s)  { return assign(s); }
+        constexpr document_string& operator=(const CharT* s) { return assign(s); }
+
+        constexpr document_string& assign(string_view s) {
+            if (s.size() > std::numeric_limits<std::uint32_t>::max()) { throw std::length_error("jxxson::document_string is too long"); }
+            const auto n = static_cast<std::uint32_t>(s.size());
+            if (n <= inline_capacity) {
+                small_rep small{n, {}};  // s may point into this string.
+                std::ranges::copy(s, small.buf);
+                release(); small_ = small;
+            } else if (!is_small() && heap_.capacity >= n) {
+                std::char_traits<CharT>::move(heap_.ptr, s.data(), n);
+                heap_.size = n;
+            } else {
+                CharT* ptr = traits::allocate(alloc_, n);
+                std::ranges::copy(s, ptr);
+                release(); heap_ = heap_rep{n, n, ptr};
+            }
+            return *this;
+        }
+
+        constexpr void            clear() noexcept       { release(); }
+        constexpr const CharT*    data()  const noexcept { return is_small() ? small_.buf : heap_.ptr; }
+        constexpr CharT*          data()        noexcept { return is_small() ? small_.buf : heap_.ptr; }
+        constexpr size_type       size()  const noexcept { return small_.size; }
+        constexpr bool            empty() const noexcept { return small_.size == 0; }
+        constexpr const_iterator  begin() const noexcept { return data(); }
+        constexpr const_iterator  end()   const noexcept { return data() + size(); }
+        constexpr string_view     view()  const noexcept { return string_view(data(), size()); }
+        constexpr allocator_type  get_allocator() const noexcept { return alloc_; }
+        constexpr operator        string_view() const noexcept { return view(); }
+
+        friend constexpr bool operator==(const document_string& left, const document_string& right) noexcept { return left.view() == right.view(); }
+        friend constexpr bool operator==(const document_string& left, string_view right)            noexcept { return left.view() == right; }
+    };
 
-    template <typename Integer = int, typename FloatingPoint = float, class CharT = char, class BufferAllocator = std::allocator<CharT>>
+    // Value of a node, a type tag with an inline union, strings and packed arrays are the only payloads that may allocate.
+    // A packed array is an array of numbers of one type stored in one exactly sized block instead of one child node per element.
+    // A deferred container is an object or array of a lazily parsed tree whose members are still text in the tree's copy of the input.
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char, class BufferAllocator = std::allocator<CharT>>
     class document_node_value {
     public:
         using string              = std::basic_string<CharT, std::char_traits<CharT>, BufferAllocator>;
         using string_view         = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using node_string         = document_string<CharT, BufferAllocator>;
         using int_type            = Integer;
         using float_type          = FloatingPoint;
-
+    private:
+        union {
+            bool                    b_;
+            int_type                i_;
+            float_type              f_;
+            node_string             s_;
+            std::span<int_type>     ints_;
+            std::span<float_type>   floats_;
+            std::span<const CharT>  text_;
+        };
+        JXXSON_NO_UNIQUE_ADDRESS BufferAllocator alloc_;
+    public:
+        // Read only, assign another value to change the type.
         document_tree_node_type type = document_tree_node_type::null;
-        string                  buffer;
+    private:
+        document_tree_node_type packed_ = document_tree_node_type::null;  // Element type of a packed array, string for a deferred container.
+
+        template <class Ty>
+        constexpr std::span<Ty> allocate_packed(std::span<const Ty> values) {
+            using allocator = typename std::allocator_traits<BufferAllocator>::template rebind_alloc<Ty>;
+            if (values.empty()) { return {}; }
+            allocator a(alloc_);
+            Ty* ptr = std::allocator_traits<allocator>::allocate(a, values.size());
+            std::ranges::copy(values, ptr);
+            return std::span<Ty>(ptr, values.size());
+        }
+
+        template <class Ty>
+        constexpr void deallocate_packed(std::span<Ty> values) noexcept {
+            using allocator = typename std::allocator_traits<BufferAllocator>::template rebind_alloc<Ty>;
+            if (values.empty()) { return; }
+            allocator a(alloc_);
+            std::allocator_traits<allocator>::deallocate(a, values.data(), values.size());
+        }
+
+        template <class Value>
+        constexpr void construct_from(Value&& right) {
+            switch (type = right.type) {
+            default: break;
+            case document_tree_node_type::boolean:        b_ = right.b_; break;
+            case document_tree_node_type::integer:        i_ = right.i_; break;
+            case document_tree_node_type::floating_point:
+                if (right.packed_ != document_tree_node_type::string) { f_ = right.f_; break; }
+                packed_ = right.packed_;
+                [[fallthrough]];
+            case document_tree_node_type::string:
+                // Strings always use this value's allocator, a string of another allocator is copied.
+                if constexpr (std::is_rvalue_reference_v<Value&&>) { std::construct_at(&s_, std::move(right.s_), alloc_); }
+                else { std::construct_at(&s_, right.s_, alloc_); }
+                break;
+            case document_tree_node_type::array: case document_tree_node_type::object:
+                if (right.packed_ == document_tree_node_type::string) { text_ = right.text_; packed_ = right.packed_; break; }
+                // Blocks are taken over only from a value with an equal allocator, a moved from packed array is left empty.
+                if constexpr (std::is_rvalue_reference_v<Value&&>) {
+                    if (alloc_ == right.alloc_) {
+                        if (right.packed_ == document_tree_node_type::integer)        { ints_   = std::exchange(right.ints_, {}); }
+                        if (right.packed_ == document_tree_node_type::floating_point) { floats_ = std::exchange(right.floats_, {}); }
+                        packed_ = std::exchange(right.packed_, document_tree_node_type::null);
+                        break;
+                    }
+                }
+                packed_ = right.packed_;
+                if (packed_ == document_tree_node_type::integer)        { ints_   = allocate_packed<int_type>(right.ints_); }
+                if (packed_ == document_tree_node_type::floating_point) { floats_ = allocate_packed<float_type>(right.floats_); }
+                break;
+            }
+        }
+
+        constexpr void destroy() noexcept {
+            switch (packed_) {
+            case document_tree_node_type::integer:        deallocate_packed(ints_);   break;
+            case document_tree_node_type::floating_point: deallocate_packed(floats_); break;
+            case document_tree_node_type::string:         if (literal()) { std::destroy_at(&s_); } break;  // Deferred text is not owned.
+            default:                                      if (type == document_tree_node_type::string) { std::destroy_at(&s_); } break;
+            }
+            type    = document_tree_node_type::null;
+            packed_ = document_tree_node_type::null;
+        }
+    public:
+        constexpr document_node_value(const document_node_value& right)
+            : b_(false), alloc_(std::allocator_traits<BufferAllocator>::select_on_container_copy_construction(right.alloc_)) { construct_from(right); }
+        constexpr document_node_value(document_node_value&& right) noexcept : b_(false), alloc_(right.alloc_) { construct_from(std::move(right)); }
+        constexpr document_node_value(const document_node_value& right, const BufferAllocator& a) : b_(false), alloc_(a) { construct_from(right); }
+        constexpr ~document_node_value() { destroy(); }
+
+        constexpr document_node_value& operator=(const document_node_value& right) {
+            if (this == &right) { return *this; }
+            if (type == document_tree_node_type::string && right.type == document_tree_node_type::string) { s_ = right.s_; }
+            else { destroy(); construct_from(right); }
+            return *this;
+        }
+
+        // The allocator is never propagated, a value of another allocator is copied, which may throw.
+        constexpr document_node_value& operator=(document_node_value&& right) noexcept(std::allocator_traits<BufferAllocator>::is_always_equal::value) {
+            if (this == &right) { return *this; }
+            if (type == document_tree_node_type::string && right.type == document_tree_node_type::string) {
+                if (alloc_ == right.alloc_) { s_ = std::move(right.s_); }
+                else { s_.assign(right.s_.view()); }
+            }
+            else { destroy(); construct_from(std::move(right)); }
+            return *this;
+        }
 
-        constexpr document_node_value(const document_node_value&) = default;
-        constexpr document_node_value(document_node_value&&) = default;
-        constexpr document_node_value& operator=(const document_node_value&) = default;
-        constexpr document_node_value& operator=(document_node_value&&) = default;
-        constexpr ~document_node_value() = default;
+        constexpr document_node_value(const BufferAllocator& a = BufferAllocator{}) : b_(false), alloc_(a), type(document_tree_node_type::null) {}
+        constexpr document_node_value(const bool           b, const BufferAllocator a = BufferAllocator{}) : b_(b),     alloc_(a), type(document_tree_node_type::boolean)        {}
+        constexpr document_node_value(const int_type       i, const BufferAllocator a = BufferAllocator{}) : i_(i),     alloc_(a), type(document_tree_node_type::integer)        {}
+        constexpr document_node_value(const float_type     f, const BufferAllocator a = BufferAllocator{}) : f_(f),     alloc_(a), type(document_tree_node_type::floating_point) {}
+        constexpr document_node_value(const string_view    s, const BufferAllocator a = BufferAllocator{}) : s_(s, a),  alloc_(a), type(document_tree_node_type::string)         {}
+        constexpr document_node_value(const string&        s, const BufferAllocator a = BufferAllocator{}) : s_(s, a),  alloc_(a), type(document_tree_node_type::string)         {}
+        constexpr document_node_value(const CharT*         s, const BufferAllocator a = BufferAllocator{}) : s_(s, a),  alloc_(a), type(document_tree_node_type::string)         {}
 
-        constexpr document_node_value(const BufferAllocator& a = BufferAllocator{}) : type(document_tree_node_type::null), buffer(a) {}
-        constexpr document_node_value(const bool           b, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::boolean),          buffer(reinterpret_cast<const char*>(&b), sizeof(b), a) {}
-        constexpr document_node_value(const int_type       i, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::integer),          buffer(reinterpret_cast<const char*>(&i), sizeof(i), a) {}
-        constexpr document_node_value(const float_type     f, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::floating_point),   buffer(reinterpret_cast<const char*>(&f), sizeof(f), a) {}
-        constexpr document_node_value(const string_view    s, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::string),           buffer(s, a) {}
-        constexpr document_node_value(const string&        s, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::string),           buffer(s, a) {}
-        constexpr document_node_value(const CharT*         s, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::string),           buffer(s, a) {}
+        constexpr document_node_value(const decltype(document_node_root_tag),   const BufferAllocator a = BufferAllocator{}) : b_(false), alloc_(a), type(document_tree_node_type::root)   {}
+        constexpr document_node_value(const decltype(document_node_array_tag),  const BufferAllocator a = BufferAllocator{}) : b_(false), alloc_(a), type(document_tree_node_type::array)  {}
+        constexpr document_node_value(const decltype(document_node_object_tag), const BufferAllocator a = BufferAllocator{}) : b_(false), alloc_(a), type(document_tree_node_type::object) {}
 
-        constexpr document_node_value(const decltype(document_node_root_tag)   r, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::root),   buffer(reinterpret_cast<const char*>(&r), sizeof(r), a) {}
-        constexpr document_node_value(const decltype(document_node_array_tag)  r, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::array),  buffer(reinterpret_cast<const char*>(&r), sizeof(r), a) {}
-        constexpr document_node_value(const decltype(document_node_object_tag) r, const BufferAllocator a = BufferAllocator{}) : type(document_tree_node_type::object), buffer(reinterpret_cast<const char*>(&r), sizeof(r), a) {}
+        // Numbers no number type holds exactly, text is a json number and is written back as it is.
+        constexpr document_node_value(const decltype(document_node_number_tag), const string_view text, const BufferAllocator a = BufferAllocator{})
+            : s_(text, a), alloc_(a), type(document_tree_node_type::floating_point), packed_(document_tree_node_type::string) {}
 
-        template <typename Ty> constexpr Ty& as() {
-            if constexpr (std::is_same_v<Ty, string>) { return buffer; }
-            return *reinterpret_cast<Ty*>(buffer.data());
+        // Packed arrays, values are copied.
+        constexpr document_node_value(std::span<const int_type>   v, const BufferAllocator a = BufferAllocator{})
+            : b_(false), alloc_(a), type(document_tree_node_type::array), packed_(document_tree_node_type::integer)        { ints_   = allocate_packed(v); }
+        constexpr document_node_value(std::span<const float_type> v, const BufferAllocator a = BufferAllocator{})
+            : b_(false), alloc_(a), type(document_tree_node_type::array), packed_(document_tree_node_type::floating_point) { floats_ = allocate_packed(v); }
+
+        // Deferred containers, text runs from the opening bracket to past the closing one and is not copied.
+        constexpr document_node_value(const decltype(document_node_array_tag),  std::span<const CharT> text, const BufferAllocator a = BufferAllocator{})
+            : text_(text), alloc_(a), type(document_tree_node_type::array),  packed_(document_tree_node_type::string) {}
+        constexpr document_node_value(const decltype(document_node_object_tag), std::span<const CharT> text, const BufferAllocator a = BufferAllocator{})
+            : text_(text), alloc_(a), type(document_tree_node_type::object), packed_(document_tree_node_type::string) {}
+
+        // Ty must match type, strings are accessed with node_string (string and string_view are accepted too).
+        // Elements of packed arrays are accessed with std::span of int_type or float_type, which is empty if the elements are of the other type.
+        // A number kept as text reads as the closest float_type, mutable access replaces the text with that float.
+        template <typename Ty> constexpr decltype(auto) as() {
+            if constexpr (std::is_same_v<Ty, bool>)            { return (b_); }
+            else if constexpr (std::is_same_v<Ty, int_type>)   { return (i_); }
+            else if constexpr (std::is_same_v<Ty, float_type>) {
+                if (literal()) {
+                    const float_type f = detail::literal_value<float_type>(s_.view());
+                    std::destroy_at(&s_);
+                    packed_ = document_tree_node_type::null;
+                    f_      = f;
+                }
+                return (f_);
+            }
+            else if constexpr (std::is_same_v<Ty, std::span<int_type>>   || std::is_same_v<Ty, std::span<const int_type>>)   { return packed_ == document_tree_node_type::integer        ? Ty(ints_)   : Ty(); }
+            else if constexpr (std::is_same_v<Ty, std::span<float_type>> || std::is_same_v<Ty, std::span<const float_type>>) { return packed_ == document_tree_node_type::floating_point ? Ty(floats_) : Ty(); }
+            else { return (s_); }
         }
 
         template <typename Ty> constexpr auto as() const {
-            if constexpr (std::is_same_v<Ty, string>) { return string_view(buffer); }
-            return *reinterpret_cast<const Ty*>(buffer.data());
+            if constexpr (std::is_same_v<Ty, bool>)            { return b_; }
+            else if constexpr (std::is_same_v<Ty, int_type>)   { return i_; }
+            else if constexpr (std::is_same_v<Ty, float_type>) { return literal() ? detail::literal_value<float_type>(s_.view()) : f_; }
+            else if constexpr (std::is_same_v<Ty, std::span<const int_type>>)   { return packed_ == document_tree_node_type::integer        ? Ty(ints_)   : Ty(); }
+            else if constexpr (std::is_same_v<Ty, std::span<const float_type>>) { return packed_ == document_tree_node_type::floating_point ? Ty(floats_) : Ty(); }
+            else { return s_.view(); }
         }
 
+        // Element type of a packed array (integer or floating_point), null for every other value.
+        // Elements of a packed array are not child nodes of the tree.
+        constexpr document_tree_node_type packed_type() const noexcept { return packed() ? packed_ : document_tree_node_type::null; }
+        constexpr bool                    packed()      const noexcept { return packed_ == document_tree_node_type::integer || packed_ == document_tree_node_type::floating_point; }
+
+        // Members of a deferred container are not child nodes of the tree until it is materialized.
+        constexpr bool                    deferred()      const noexcept { return packed_ == document_tree_node_type::string && parent_type(); }
+        constexpr string_view             deferred_text() const noexcept { return deferred() ? string_view(text_.data(), text_.size()) : string_view(); }
+
+        // A floating_point value that keeps the text it was parsed from, see document_node_number_tag.
+        constexpr bool                    literal()       const noexcept { return packed_ == document_tree_node_type::string && type == document_tree_node_type::floating_point; }
+        constexpr string_view             literal_text()  const noexcept { return literal() ? s_.view() : string_view(); }
+
         constexpr bool parent_type()   const { return type == document_tree_node_type::object || type == document_tree_node_type::array || type == document_tree_node_type::root; }
-        constexpr auto get_allocator() const { return buffer.get_allocator(); }
+        constexpr auto get_allocator() const { return alloc_; }
 
-        // This is a value formatter.
         template <bool IsBegin, class OutputIt>
-        constexpr OutputIt format_to(OutputIt out) {
-            constexpr CharT  out_null [4]  = {CharT{'n'}, CharT{'u'}, CharT{'l'}, CharT{'l'}};
-            constexpr CharT  out_true [4]  = {CharT{'t'}, CharT{'r'}, CharT{'u'}, CharT{'e'}};
-            constexpr CharT  out_false[5]  = {CharT{'f'}, CharT{'a'}, CharT{'l'}, CharT{'s'}, CharT{'e'}};
-            if constexpr (IsBegin) {
-                switch (type) {
-                case document_tree_node_type::null:    {          out = std::ranges::copy(out_null, out).out; break; } 
-                case document_tree_node_type::boolean: {
-                    if (as<bool>()) { out = std::ranges::copy(out_true, out).out; }
-                    else { out = std::ranges::copy(out_false, out).out; }
-                    break;
-                }
-                case document_tree_node_type::integer: {
-                    if constexpr (std::is_same_v<CharT, wchar_t>) {
-                        out = std::ranges::copy(std::format(L"{:d}", as<int_type>()), out).out; break;
-                    } else { out = std::ranges::copy(std::format("{:d}", as<int_type>()), out).out; break; }
-                }
-                case document_tree_node_type::floating_point: {
-                    if constexpr (std::is_same_v<CharT, wchar_t>) {
-                        out = std::ranges::copy(std::format(L"{:f}", as<float_type>()), out).out; break;
-                    } else { out = std::ranges::copy(std::format("{:f}", as<float_type>()), out).out; break; }
-                }
-                case document_tree_node_type::string:           { *out++ = CharT{'\"'}; out = std::ranges::copy(buffer, out).out; *out++ = CharT{'\"'}; break; }
-                case document_tree_node_type::object: *out++ = CharT{'{'}; break;
-                case document_tree_node_type::array:  *out++ = CharT{'['}; break;
-                case document_tree_node_type::root: break;
-                }
-            } else {
-                switch (type) {
-                default: break;
-                case document_tree_node_type::object: *out++ = CharT{'}'}; break;
-                case document_tree_node_type::array:  *out++ = CharT{']'}; break; 
-                }
-            }
-            return out;
+        constexpr OutputIt format_to(OutputIt out) const {
+            detail::format_sink<CharT, detail::iterator_flush<CharT, OutputIt>, 64> sink({out});
+            detail::write_value<IsBegin>(*this, sink);
+            sink.flush();
+            return sink.flush_to.out;
         }
         
     };
 
-    template <typename Integer = int, typename FloatingPoint = float, class CharT = char, class BufferAllocator = std::allocator<CharT>>
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char, class BufferAllocator = std::allocator<CharT>>
     class document_tree_node {
     public:
         using string              = std::basic_string<CharT, std::char_traits<CharT>, BufferAllocator>;
@@ -146,17 +1084,21 @@ namespace jxxson {
         using int_type            = Integer;
         using float_type          = FloatingPoint;
         using value_type          = document_node_value<int_type, float_type, CharT, BufferAllocator>;
+        using node_string         = typename value_type::node_string;
     private:
-        string            name_;
+        node_string       name_;
         value_type        value_;
         std::ptrdiff_t    pid_ = -1;
         bool              tombed_ = false;
     public:
         constexpr document_tree_node(pointer parent, pointer beg, string_view n, value_type v)
-            : name_(n), value_(std::move(v)), pid_(parent != nullptr ? parent - beg : -1) {}
+            : name_(n, v.get_allocator()), value_(std::move(v)), pid_(parent != nullptr ? parent - beg : -1) {}
 
         constexpr document_tree_node(std::ptrdiff_t pid, string_view n, value_type v)
-            : name_(n), value_(std::move(v)), pid_(pid) {}
+            : name_(n, v.get_allocator()), value_(std::move(v)), pid_(pid) {}
+
+        constexpr document_tree_node(std::ptrdiff_t pid, node_string&& n, value_type&& v)
+            : name_(std::move(n)), value_(std::move(v)), pid_(pid) {}
 
         constexpr document_tree_node()                                       = default;
         constexpr document_tree_node(const document_tree_node&)              = default;
@@ -167,10 +1109,10 @@ namespace jxxson {
 
         constexpr bool              dying()           const { return tombed_; }
         constexpr void              dying(bool v)           { tombed_ = v; }
-        constexpr string&           name()                  { return name_; }
+        constexpr node_string&      name()                  { return name_; }
         constexpr string_view       name()            const { return name_; }
         constexpr value_type&       value()                 { return value_; }
-        constexpr value_type        value()           const { return value_; }
+        constexpr const value_type& value()           const { return value_; }
         constexpr auto              get_allocator()   const { return value_.get_allocator(); }
         constexpr std::ptrdiff_t&   parent_index()          { return pid_; }
         constexpr std::ptrdiff_t    parent_index()    const { return pid_; }
@@ -235,8 +1177,11 @@ namespace jxxson {
         constexpr document_tree_node_const_iterator begin()                   const { return tree_ptr_->search_child_begin(*this); }
         constexpr document_tree_node_const_iterator end()                     const { return tree_ptr_->search_child_end(*this); }
         constexpr std::size_t                       size()                    const { return end() - begin(); }
-        constexpr auto                              find(string_view name) const { return tree_ptr_->access(*this, name); }
-        constexpr auto                              find(std::size_t id)   const { return tree_ptr_->access(*this, id); }
+        constexpr auto                              find(string_view name) const { return std::as_const(*tree_ptr_).access(*this, name); }
+        constexpr auto                              find(std::size_t id)   const { return std::as_const(*tree_ptr_).access(*this, id); }
+        constexpr auto                              operator[](string_view name) const { return std::as_const(*tree_ptr_).access(*this, name); }
+        constexpr auto                              operator[](std::size_t id)   const { return std::as_const(*tree_ptr_).access(*this, id); }
+        constexpr auto                              element(std::size_t id)      const { return std::as_const(*tree_ptr_).element(*this, id); }
     };
 
     template <class JsonTree>
@@ -307,6 +1252,7 @@ namespace jxxson {
         constexpr auto   find(std::size_t id)               { return tree_ptr_->access(*this, id); }
         constexpr auto   find(string_view name)       const { return tree_ptr_->access(*this, name); }
         constexpr auto   find(std::size_t id)         const { return tree_ptr_->access(*this, id); }
+        constexpr auto   element(std::size_t id)      const { return std::as_const(*tree_ptr_).element(*this, id); }
 
         constexpr document_tree_node_iterator remove() {
             tree_ptr_->remove(*this);
@@ -315,7 +1261,7 @@ namespace jxxson {
     };
     
     template <typename Integer         = int,
-              typename FloatingPoint   = float,
+              typename FloatingPoint   = double,
               class CharT              = char,
               class BufferAllocator    = std::allocator<CharT>,
               template <class Ty> class TreeAllocator = std::allocator
@@ -326,6 +1272,7 @@ namespace jxxson {
         using string_view        = std::basic_string_view<CharT, std::char_traits<CharT>>;
         using string             = std::basic_string<CharT, std::char_traits<CharT>, BufferAllocator>;
         using node_value         = document_node_value<Integer, FloatingPoint, CharT, BufferAllocator>;
+        using node_string        = typename node_value::node_string;
         using float_type         = FloatingPoint;
         using int_type           = Integer;
 
@@ -344,7 +1291,7 @@ namespace jxxson {
         }
 
         constexpr container_iterator emplace(container_iterator parent, string_view name, node_value&& value, const BufferAllocator& ba = BufferAllocator{}) {
-            std::size_t d = 1; for (auto it = parent; it != root(); it = it->parent) { ++d; }
+            const std::size_t d = parent->depth + 1;
             tail_ = nodes_.emplace_after(tail_, d, parent, name, std::move(value), ba);
             max_depth_ = std::max(max_depth_, d); ++size_;
             return tail_;
@@ -360,7 +1307,7 @@ namespace jxxson {
         struct inserter_node {
             std::size_t        depth;
             container_iterator parent;
-            string             name;
+            node_string        name;
             node_value         value;
             std::size_t        index = 0;
             constexpr inserter_node(std::size_t d, container_iterator parent, string_view name, node_value&& value, const BufferAllocator& ba = BufferAllocator{})
@@ -372,18 +1319,334 @@ namespace jxxson {
         std::size_t        size_ = 0;
     };
 
-    template <typename Integer         = int,
-              typename FloatingPoint   = float,
-              class    CharT           = char,
-              class    BufferAllocator = std::allocator<CharT>,
-              class    TreeAllocator   = std::allocator<document_tree_node<Integer, FloatingPoint, CharT, BufferAllocator>>
-    >
-    class document_tree {
-    public:
-        using string_view       = std::basic_string_view<CharT, std::char_traits<CharT>>;
-        using string            = std::basic_string<CharT, std::char_traits<CharT>, BufferAllocator>;
-        using node_value        = document_node_value<Integer, FloatingPoint, CharT, BufferAllocator>;
-        using float_type        = FloatingPoint;
+    namespace detail {
+        // Reads one level of the container opening at beg and hands every member to emit(name, value), nested containers
+        // become deferred values of their text again. True if the container is well formed, stop is then past its closing
+        // bracket, otherwise where the malformed member starts (the members before it are emitted).
+        template <class Value, class Emit>
+        constexpr bool parse_deferred_level(const scan_kernels& scan, const char* beg, const char* end, const decltype(std::declval<Value>().get_allocator())& a,
+                                            const char*& stop, Emit&& emit) {
+            using string = std::basic_string<char, std::char_traits<char>, std::remove_cvref_t<decltype(a)>>;
+            const bool is_object = *beg == '{';
+            const char closing   = is_object ? '}' : ']';
+            string     key(a), decoded(a);
+            auto       fail = [&stop](const char* at) { stop = at; return false; };
+            if ((beg = scan.skip_spaces(beg + 1, end)) != end && *beg == closing) { stop = beg + 1; return true; }
+            for (;;) {
+                const char*      at = beg;
+                std::string_view name;
+                if (is_object) {
+                    bool        escaped = false;
+                    const char* close   = beg != end && *beg == '\"' ? find_string_close(scan, beg + 1, end, escaped) : end;
+                    if (close == end) { return fail(at); }
+                    name = std::string_view(beg + 1, static_cast<std::size_t>(close - beg - 1));
+                    if (escaped) { key.clear(); unescape_to(key, beg + 1, close); name = key; }
+                    if ((beg = scan.skip_spaces(close + 1, end)) == end || *beg != ':') { return fail(at); }
+                    beg = scan.skip_spaces(beg + 1, end);
+                }
+                if (beg == end) { return fail(at); }
+                switch (*beg) {
+                case '{': case '[': {
+                    const char* close = find_container_end(scan, beg, end);
+                    if (close == nullptr) { return fail(at); }
+                    const std::span<const char> text(beg, close);
+                    if (scan.skip_spaces(beg + 1, close - 1) == close - 1) {
+                        emit(name, *beg == '{' ? Value(document_node_object_tag, a) : Value(document_node_array_tag, a));
+                    } else { emit(name, *beg == '{' ? Value(document_node_object_tag, text, a) : Value(document_node_array_tag, text, a)); }
+                    beg = close;
+                } break;
+                case '\"': {
+                    bool        escaped = false;
+                    const char* close   = find_string_close(scan, beg + 1, end, escaped);
+                    if (close == end) { return fail(at); }
+                    std::string_view str(beg + 1, static_cast<std::size_t>(close - beg - 1));
+                    if (escaped) { decoded.clear(); unescape_to(decoded, beg + 1, close); str = decoded; }
+                    emit(name, Value(str, a));
+                    beg = close + 1;
+                } break;
+                case 't': if (!match_literal(beg, end, "true"))  { return fail(at); } emit(name, Value(true, a));  beg += 4; break;
+                case 'f': if (!match_literal(beg, end, "false")) { return fail(at); } emit(name, Value(false, a)); beg += 5; break;
+                case 'n': if (!match_literal(beg, end, "null"))  { return fail(at); } emit(name, Value(a));        beg += 4; break;
+                default: {
+                    number_value<typename Value::int_type, typename Value::float_type> num;
+                    const char* num_end = parse_number(beg, end, num);
+                    if (num_end == nullptr) { return fail(at); }
+                    emit(name, num.literal ? Value(document_node_number_tag, std::string_view(beg, num_end), a) : num.is_float ? Value(num.f, a) : Value(num.i, a));
+                    beg = num_end;
+                } break;
+                }
+                if ((beg = scan.skip_spaces(beg, end)) == end) { return fail(at); }
+                if (*beg == closing) { stop = beg + 1; return true; }
+                if (*beg != ',') { return fail(beg); }
+                beg = scan.skip_spaces(beg + 1, end);
+            }
+        }
+
+        // Elements of a packed array, laid out as child nodes of depth would be.
+        template <class Ty, class Sink>
+        constexpr void format_packed_elements(const format_style& style, std::size_t depth, std::span<const Ty> values, Sink& sink) {
+            using char_type = typename Sink::char_type;
+            for (std::size_t i = 0; i != values.size(); ++i) {
+                if (style.pretty) { sink.fill(depth * style.indent, char_type{' '}); }
+                write_number(values[i], sink);
+                if (i + 1 != values.size()) { sink.put(char_type{','}); }
+                if (style.pretty) { sink.put(char_type{'\n'}); }
+            }
+        }
+
+        // Printer shared by all tree types, it only walks const iterators of a tree.
+        template <class ConstIterator, class Sink>
+        constexpr void format_node_begin(const format_style& style, std::size_t depth, ConstIterator it, bool is_last_sibling, Sink& sink) {
+            using char_type = typename Sink::char_type;
+            const auto& value = it->value();
+            if (style.pretty) { sink.fill(depth * style.indent, char_type{' '}); }
+            if (!it->name().empty()) {
+                sink.put(char_type{'\"'});
+                escape_to(it->name(), sink);
+                sink.put(char_type{'\"'});
+                sink.put(char_type{':'});
+            }
+            write_value<true>(value, sink);
+            if (!value.parent_type() && !is_last_sibling) { sink.put(char_type{','}); }
+            if (style.pretty) { sink.put(char_type{'\n'}); }
+            if constexpr (requires { value.packed_type(); }) {
+                using value_type = std::remove_cvref_t<decltype(value)>;
+                if (value.packed_type() == document_tree_node_type::integer) {
+                    format_packed_elements(style, depth + 1, value.template as<std::span<const typename value_type::int_type>>(), sink);
+                } else if (value.packed_type() == document_tree_node_type::floating_point) {
+                    format_packed_elements(style, depth + 1, value.template as<std::span<const typename value_type::float_type>>(), sink);
+                }
+            }
+        }
+
+        template <class ConstIterator, class Sink>
+        constexpr void format_node_end(const format_style& style, std::size_t depth, ConstIterator it, bool is_last_sibling, Sink& sink) {
+            using char_type = typename Sink::char_type;
+            const bool is_parent_t_node = it->value().parent_type();
+            if (is_parent_t_node && style.pretty) { sink.fill(depth * style.indent, char_type{' '}); }
+            write_value<false>(it->value(), sink);
+            if (is_parent_t_node) {
+                if (!is_last_sibling) { sink.put(char_type{','}); }
+                if (style.pretty) { sink.put(char_type{'\n'}); }
+            }
+        }
+
+        template <class ConstIterator, class Sink>
+        constexpr void format_subtree_to(const format_style& style, std::size_t depth, ConstIterator it, bool is_last_sibling, Sink& sink) {
+            format_node_begin(style, depth, it, is_last_sibling, sink);
+            for (auto c = it.begin(), e = it.end(); c != e; ++c) {
+                format_subtree_to(style, depth + 1, c, c + 1 == e, sink);
+            }
+            format_node_end(style, depth, it, is_last_sibling, sink);
+        }
+
+        // Formats everything below the root node of a tree.
+        template <class Tree, class Sink>
+        constexpr void format_tree_to(const Tree& tree, const format_style& style, Sink& sink) {
+            // Deferred containers are formatted from a materialized copy, so the output is the same as for an eager parse.
+            if constexpr (requires { tree.deferred(); }) {
+                if (tree.deferred()) { Tree copy(tree); copy.materialize(); return format_tree_to(copy, style, sink); }
+            }
+            if (tree.size() > 1) { format_subtree_to(style, 0, tree.begin() + 1, true, sink); }
+            sink.flush();
+        }
+
+        // Formats a tree on several threads into pieces that are handed to write(data, size) in document order by the
+        // calling thread, so the output is the same as format_tree_to. Subtrees and runs of siblings of about
+        // size() / (threads * 8) nodes are formatted as a whole, only bigger subtrees are split between their children.
+        // The calling thread writes every piece as soon as all pieces before it are done and formats pieces while it waits.
+        template <class Tree, class Write>
+        void format_tree_parallel_to(const Tree& tree, const format_style& style, std::size_t threads, Write&& write) {
+            using char_type      = typename Tree::string_view::value_type;
+            using const_iterator = decltype(tree.begin());
+            using string         = std::basic_string<char_type>;
+            auto flush_to = [&write](const char_type* p, std::size_t n) { write(p, n); };
+            if constexpr (requires { tree.deferred(); }) {
+                if (tree.deferred()) { Tree copy(tree); copy.materialize(); return format_tree_parallel_to(copy, style, threads, write); }
+            }
+            if (threads < 2 || tree.size() < threads * 16384) {
+                format_sink<char_type, decltype(flush_to)> sink(flush_to);
+                format_tree_to(tree, style, sink);
+                return;
+            }
+
+            // Subtree sizes, children always come after their parent in BFVT.
+            std::vector<std::size_t> sizes(tree.size(), 1);
+            for (std::size_t i = tree.size() - 1; i != 0; --i) { sizes[static_cast<std::size_t>(tree.data()[i].parent_index())] += sizes[i]; }
+            const std::size_t grain = std::max<std::size_t>(tree.size() / (threads * 8), 1024);
+
+            // A piece is either text (empty slice) or a run of siblings, the last one is followed by more siblings unless is_last.
+            struct piece {
+                const_iterator first;
+                std::size_t    count   = 0;
+                std::size_t    depth   = 0;
+                bool           is_last = false;
+                string         text;
+            };
+            std::vector<piece> pieces;
+            auto text = [&]() -> string& {
+                if (pieces.empty() || pieces.back().count != 0) { pieces.push_back(piece{tree.begin(), 0, 0, false, string()}); }
+                return pieces.back().text;
+            };
+            auto plan = [&](auto& self, const_iterator it, std::size_t depth, bool is_last) -> void {
+                if (sizes[static_cast<std::size_t>(it - tree.begin())] <= grain || it.begin() == it.end()) {
+                    pieces.push_back(piece{it, 1, depth, is_last, string()});
+                    return;
+                }
+                {
+                    auto append = [&](const char_type* p, std::size_t n) { text().append(p, n); };
+                    format_sink<char_type, decltype(append), 256> sink(append);
+                    format_node_begin(style, depth, it, is_last, sink);
+                    sink.flush();
+                }
+                const auto  last = it.end();
+                auto        run  = it.begin();
+                std::size_t run_size = 0;
+                for (auto c = it.begin(); c != last; ++c) {
+                    const std::size_t n = sizes[static_cast<std::size_t>(c - tree.begin())];
+                    if (n > grain) {
+                        if (c != run) { pieces.push_back(piece{run, static_cast<std::size_t>(c - run), depth + 1, false, string()}); }
+                        self(self, c, depth + 1, c + 1 == last);
+                        run = c + 1; run_size = 0;
+                    } else if ((run_size += n) >= grain) {
+                        pieces.push_back(piece{run, static_cast<std::size_t>(c + 1 - run), depth + 1, c + 1 == last, string()});
+                        run = c + 1; run_size = 0;
+                    }
+                }
+                if (run != last) { pieces.push_back(piece{run, static_cast<std::size_t>(last - run), depth + 1, true, string()}); }
+                auto append = [&](const char_type* p, std::size_t n) { text().append(p, n); };
+                format_sink<char_type, decltype(append), 256> sink(append);
+                format_node_end(style, depth, it, is_last, sink);
+                sink.flush();
+            };
+            plan(plan, tree.begin() + 1, 0, true);
+
+            // 0 waiting, 1 done, 2 failed. Text pieces are done from the start.
+            const std::size_t               n = pieces.size();
+            std::vector<std::atomic<int>>   state(n);
+            std::vector<std::exception_ptr> errors(n);
+            std::atomic<std::size_t>        next = 0;
+            for (std::size_t i = 0; i != n; ++i) { if (pieces[i].count == 0) { state[i].store(1, std::memory_order_relaxed); } }
+            auto format_one = [&](std::size_t i) {
+                piece& p = pieces[i];
+                if (p.count != 0) {
+                    try {
+                        auto append = [&p](const char_type* b, std::size_t k) { p.text.append(b, k); };
+                        format_sink<char_type, decltype(append)> sink(append);
+                        for (std::size_t j = 0; j != p.count; ++j) {
+                            format_subtree_to(style, p.depth, p.first + j, j + 1 == p.count && p.is_last, sink);
+                        }
+                        sink.flush();
+                        state[i].store(1, std::memory_order_release);
+                    } catch (...) { errors[i] = std::current_exception(); state[i].store(2, std::memory_order_release); }
+                    state[i].notify_all();
+                }
+            };
+            auto work = [&] { for (std::size_t i; (i = next.fetch_add(1)) < n;) { format_one(i); } };
+            std::vector<std::jthread> workers;
+            workers.reserve(threads - 1);
+            try {
+                for (std::size_t t = 1; t != threads; ++t) { workers.emplace_back(work); }
+                for (std::size_t i = 0; i != n; ++i) {
+                    while (state[i].load(std::memory_order_acquire) == 0) {
+                        if (const std::size_t j = next.fetch_add(1); j < n) { format_one(j); }
+                        else { state[i].wait(0, std::memory_order_acquire); }
+                    }
+                    if (errors[i]) { std::rethrow_exception(errors[i]); }
+                    write(pieces[i].text.data(), pieces[i].text.size());
+                    string().swap(pieces[i].text);
+                }
+            } catch (...) {
+                next.store(n);
+                throw;
+            }
+        }
+
+        // Builds first child and child count of every node, nodes must be in BFVT order.
+        template <class Nodes, class ChildIndex>
+        constexpr void build_child_index(const Nodes& nodes, ChildIndex& index) {
+            index.resize(nodes.size());  // Unlike assign, resize grows geometrically.
+            std::ranges::fill(index, typename ChildIndex::value_type{});
+            for (std::size_t i = 1; i < nodes.size(); ++i) {
+                auto& range = index[static_cast<std::size_t>(nodes[i].parent_index())];
+                if (range.count++ == 0) { range.first = i; }
+            }
+        }
+    }
+
+    namespace detail {
+        // Runs fn(0) .. fn(n - 1), fn(0) on the calling thread. The first exception is rethrown once every thread has joined.
+        template <class Fn>
+        void parallel_for(std::size_t n, Fn&& fn) {
+            if (n == 0) { return; }
+            std::vector<std::exception_ptr> errors(n);
+            std::vector<std::thread>        workers;
+            workers.reserve(n - 1);
+            for (std::size_t i = 1; i < n; ++i) {
+                workers.emplace_back([&, i] { try { fn(i); } catch (...) { errors[i] = std::current_exception(); } });
+            }
+            try { fn(std::size_t{0}); } catch (...) { errors[0] = std::current_exception(); }
+            for (auto& w : workers) { w.join(); }
+            for (auto& e : errors) { if (e) { std::rethrow_exception(e); } }
+        }
+
+        // Position right after a comma inside a container, and the containers open there (true for objects).
+        struct split_point {
+            const char*       pos;
+            std::vector<bool> open;
+        };
+
+        // Structural pre-scan for parallel parsing: brackets and strings are followed up to every part boundary,
+        // from there on the first comma inside a container is a place where a new parser can start.
+        inline std::vector<split_point> find_split_points(const scan_kernels& scan, const char* beg, const char* end, std::size_t parts) {
+            std::vector<split_point> splits;
+            std::vector<bool>        open;
+            const char*              it = beg;
+            auto step = [&] {
+                switch (*it) {
+                case '\"': { bool escaped = false; it = find_string_close(scan, it + 1, end, escaped); if (it != end) { ++it; } } return;
+                case '{': case '[': open.push_back(*it == '{'); break;
+                case '}': case ']': if (!open.empty()) { open.pop_back(); } break;
+                default: break;
+                }
+                ++it;
+            };
+            for (std::size_t k = 1; k < parts && it != end; ++k) {
+                const char* target = beg + (end - beg) * static_cast<std::ptrdiff_t>(k) / static_cast<std::ptrdiff_t>(parts);
+                while (it < target && (it = scan.find_structural(it, end)) != end) { step(); }
+                for (;it != end; step()) {
+                    if (*it == ',' && !open.empty()) { splits.push_back(split_point{++it, open}); break; }
+                }
+            }
+            return splits;
+        }
+    }
+
+    // Children of a node are always contiguous in BFVT, so they are described by their first index and count.
+    struct document_tree_child_range {
+        std::size_t first = 0;
+        std::size_t count = 0;
+    };
+
+    template <class JsonTree>
+    class document_tree_edit;
+
+    template <typename Integer, typename FloatingPoint, class CharT>
+    class document_node_value_view;
+
+    template <typename Integer         = int,
+              typename FloatingPoint   = double,
+              class    CharT           = char,
+              class    BufferAllocator = std::allocator<CharT>,
+              class    TreeAllocator   = std::allocator<document_tree_node<Integer, FloatingPoint, CharT, BufferAllocator>>
+    >
+    class document_tree {
+    public:
+        using string_view       = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using string            = std::basic_string<CharT, std::char_traits<CharT>, BufferAllocator>;
+        using node_value        = document_node_value<Integer, FloatingPoint, CharT, BufferAllocator>;
+        using node_string       = typename node_value::node_string;
+        using float_type        = FloatingPoint;
         using int_type          = Integer;
         
         using allocator_type    = TreeAllocator;
@@ -402,9 +1665,78 @@ namespace jxxson {
 
         using iterator               = document_tree_node_iterator<document_tree>;
         using const_iterator         = document_tree_node_const_iterator<document_tree>;
+        using value_view             = document_node_value_view<Integer, FloatingPoint, CharT>;
+        using child_index_type       = std::vector<document_tree_child_range, typename std::allocator_traits<allocator_type>::template rebind_alloc<document_tree_child_range>>;
+
+        static constexpr std::size_t no_key_index = std::numeric_limits<std::size_t>::max();
     protected:
-        container             nodes_;
-        static constexpr auto upper_bound_proj = [](const value_type& v) { return v.parent_index(); };
+        // Open addressing table of one object, slots hold child offset + 1 (0 is empty) and are probed by name hash.
+        struct key_table {
+            std::vector<std::uint32_t, typename std::allocator_traits<allocator_type>::template rebind_alloc<std::uint32_t>> slots;
+            std::size_t                                                                                                 count = 0;
+        };
+        using key_index_type = std::unordered_map<std::size_t, key_table, std::hash<std::size_t>, std::equal_to<std::size_t>,
+                                                  typename std::allocator_traits<allocator_type>::template rebind_alloc<std::pair<const std::size_t, key_table>>>;
+
+        container                     nodes_;
+        child_index_type              child_index_;
+        std::shared_ptr<const string> source_;  // Input of a lazy parse, deferred containers point into it.
+        bool                          indexed_ = true;
+        key_index_type                key_index_;
+        std::size_t                   key_index_threshold_ = no_key_index;
+        static constexpr auto         upper_bound_proj = [](const value_type& v) { return v.parent_index(); };
+
+        static constexpr std::size_t hash_name_(string_view name) { return std::hash<string_view>{}(name); }
+
+        // First equal name wins, same as a linear scan.
+        static constexpr void insert_key_(key_table& table, const_pointer first, std::size_t offset) {
+            const std::size_t mask = table.slots.size() - 1;
+            for (std::size_t h = hash_name_(first[offset].name()) & mask;; h = (h + 1) & mask) {
+                if (table.slots[h] == 0) { table.slots[h] = static_cast<std::uint32_t>(offset + 1); ++table.count; return; }
+                if (first[table.slots[h] - 1].name() == first[offset].name()) { return; }
+            }
+        }
+
+        static constexpr void fill_key_table_(key_table& table, const_pointer first, std::size_t count) {
+            table.slots.assign(std::bit_ceil(count * 2 + 1), 0);
+            table.count = 0;
+            for (std::size_t i = 0; i != count; ++i) { insert_key_(table, first, i); }
+        }
+
+        static constexpr const_pointer lookup_key_(const key_table& table, const_pointer first, string_view name) {
+            const std::size_t mask = table.slots.size() - 1;
+            for (std::size_t h = hash_name_(name) & mask; table.slots[h] != 0; h = (h + 1) & mask) {
+                if (first[table.slots[h] - 1].name() == name) { return first + (table.slots[h] - 1); }
+            }
+            return nullptr;
+        }
+
+        // Tables are built on first lookup of an object with enough children.
+        constexpr const key_table*   acquire_key_table_(std::size_t parent) {
+            if (key_index_threshold_ == no_key_index) { return nullptr; }
+            if (auto it = key_index_.find(parent); it != key_index_.end()) { return &it->second; }
+            const auto actual_root = const_iterator(this, data() + parent);
+            const auto beg = search_child_begin(actual_root), end = search_child_end(actual_root);
+            if (actual_root->value().type != document_tree_node_type::object || static_cast<std::size_t>(end - beg) < key_index_threshold_) { return nullptr; }
+            auto& table = key_index_.try_emplace(parent, key_table{decltype(key_table::slots)(nodes_.get_allocator()), 0}).first->second;
+            fill_key_table_(table, &*beg, end - beg);
+            return &table;
+        }
+
+        constexpr const key_table*   find_key_table_(std::size_t parent) const {
+            if (key_index_.empty()) { return nullptr; }
+            auto it = key_index_.find(parent);
+            return it != key_index_.end() ? &it->second : nullptr;
+        }
+
+        constexpr void               clear_key_index_() noexcept { key_index_.clear(); }
+
+        constexpr void               require_materialized_(const_iterator node) const {
+            if (node->value().deferred()) { throw std::logic_error("jxxson: container is not materialized, call materialize() first"); }
+        }
+
+        // String allocator of the tree, the root keeps it.
+        constexpr BufferAllocator    buffer_allocator_() const { return nodes_.front().value().get_allocator(); }
 
         template <class ... Args>
         constexpr document_tree(allocator_type alloc, std::size_t init_cap, pointer parent, Args&& ... args) : nodes_(alloc) {
@@ -415,7 +1747,20 @@ namespace jxxson {
 
         template <class ... Args>
         constexpr container_iterator emplace_back_(pointer parent, Args&& ... args) {
-            return nodes_.emplace(nodes_.end(), parent, std::forward<Args>(args)...);
+            const difference_type pid = parent != nullptr ? parent - data() : -1;
+            auto it = nodes_.emplace(nodes_.end(), parent, std::forward<Args>(args)...);
+            if (indexed_) {
+                child_index_.emplace_back();
+                if (pid != -1 && child_index_[pid].count++ == 0) { child_index_[pid].first = size() - 1; }
+            }
+            // Appending never moves other children, so only the table of parent needs the new key.
+            if (auto table = key_index_.find(pid); table != key_index_.end()) {
+                const auto actual_root = const_iterator(this, data() + pid);
+                const auto beg = search_child_begin(actual_root), end = search_child_end(actual_root);
+                if ((table->second.count + 1) * 2 > table->second.slots.size()) { fill_key_table_(table->second, &*beg, end - beg); }
+                else { insert_key_(table->second, &*beg, end - beg - 1); }
+            }
+            return it;
         }
         
         template <class ... Args>
@@ -423,7 +1768,14 @@ namespace jxxson {
             auto insert_pos = std::ranges::upper_bound(nodes_, parent - data(), std::less<difference_type>(), upper_bound_proj) - nodes_.begin();
             auto update_itr = std::ranges::upper_bound(nodes_, insert_pos - 1 , std::less<difference_type>(), upper_bound_proj);
             std::ranges::for_each(update_itr, nodes_.end(), [](value_type& nd) { ++nd.parent_index(); });
-            return nodes_.emplace(nodes_.begin() + insert_pos, parent, std::forward<Args>(args)...);
+            auto it = nodes_.emplace(nodes_.begin() + insert_pos, parent, std::forward<Args>(args)...);
+            rebuild_child_index_();  // Shifting already costs O(n).
+            clear_key_index_();
+            return it;
+        }
+
+        constexpr void               rebuild_child_index_() {
+            if (indexed_) { detail::build_child_index(nodes_, child_index_); }
         }
         
         template <class ... Args>
@@ -435,67 +1787,64 @@ namespace jxxson {
             return nodes_.end();
         }
 
+        // Children of a contiguous range of nodes are a contiguous range again, so a subtree is tagged level by level.
         constexpr void               tag_current_and_all_children_to_unknow_(container_iterator root) {
             if (root == nodes_.end()) { return; }
-            root->dying(true);
-            auto beg = std::ranges::upper_bound(root, nodes_.end(), root - nodes_.begin() - 1, std::less<difference_type>(), upper_bound_proj);
-            auto end = std::ranges::upper_bound(root, nodes_.end(), root - nodes_.begin(),     std::less<difference_type>(), upper_bound_proj);
-            for (;beg != end; ++beg) { tag_current_and_all_children_to_unknow_(beg); }
-        }
-
-        constexpr container_iterator erase_single_node_and_rotate_(container_iterator which) {
-            auto dbg = std::ranges::upper_bound(nodes_, which - nodes_.begin() - 1, std::less<difference_type>(), upper_bound_proj);
-            std::ranges::for_each(dbg, nodes_.end(), [](value_type& n) { --n.parent_index(); });
-            return nodes_.erase(which);
-        }
-
-        constexpr container_iterator erase_all_unknows_(container_iterator from) {
-            for (;from != nodes_.end(); ++from) {
-                if (from->dying()) {  from = erase_single_node_and_rotate_(from); --from; }
+            for (auto lo = root, hi = root + 1; lo != hi;) {
+                std::ranges::for_each(lo, hi, [](value_type& n) { n.dying(true); });
+                auto next = std::ranges::lower_bound(hi, nodes_.end(), lo - nodes_.begin(), std::less<difference_type>(), upper_bound_proj);
+                hi = std::ranges::lower_bound(next, nodes_.end(), hi - nodes_.begin(), std::less<difference_type>(), upper_bound_proj);
+                lo = next;
             }
-            return from;
         }
 
-        ///////////////////////////////////////////////////////////////////////////////////
-        ///                             Output Method                                   ///
-        ///////////////////////////////////////////////////////////////////////////////////
-
-        template <class OutputIt>
-        constexpr OutputIt format_to_impl(std::size_t depth, const_iterator it, OutputIt out) const {
-            if (it == end()) {
-                return out;
-            }
-            const bool is_parent_t_node  = it->value().parent_type();
-            const bool is_last_sibling   = it == std::prev(it.parent().end());
-            out = std::ranges::fill_n(out, depth << 1, CharT{' '});
-            if (!it->name().empty()) {
-                *out++ = CharT{'\"'};
-                 out   = std::ranges::copy(it->name(), out).out;
-                *out++ = CharT{'\"'};
-                *out++ = CharT{':'};
-            }
-            out = it->value().template format_to<true>(out);
-            if (!is_parent_t_node && !is_last_sibling) { *out++ = CharT{','}; } *out++ = CharT{'\n'};
-            for (auto c = it.begin(); c != it.end(); ++c) {
-                out = format_to_impl(depth + 1, c, out);
-            }
-            if (is_parent_t_node) { out = std::ranges::fill_n(out, depth << 1, CharT{' '}); }
-            out = it->value().template format_to<false>(out);
-            if (is_parent_t_node) {
-                if (!is_last_sibling) { *out++ = CharT{','}; }
-                *out++ = CharT{'\n'};
+        // One stable compaction pass. Parents come before their children, so the new index of a parent is known
+        // by the time its children move, and children of erased nodes are erased with them.
+        constexpr container_iterator erase_all_unknows_(container_iterator from) {
+            using index_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<difference_type>;
+            const std::size_t first = static_cast<std::size_t>(from - nodes_.begin());
+            std::vector<difference_type, index_allocator> remap(nodes_.size(), 0, index_allocator(nodes_.get_allocator()));
+            for (std::size_t i = 0; i != first; ++i) { remap[i] = static_cast<difference_type>(i); }
+            std::size_t out = first;
+            for (std::size_t i = first; i != nodes_.size(); ++i) {
+                const difference_type pid = nodes_[i].parent_index();
+                if (nodes_[i].dying() || (pid >= 0 && remap[pid] < 0)) { remap[i] = -1; continue; }
+                if (pid >= 0) { nodes_[i].parent_index() = remap[pid]; }
+                if (out != i) { nodes_[out] = std::move(nodes_[i]); }
+                remap[i] = static_cast<difference_type>(out++);
             }
-            return out;
+            nodes_.erase(nodes_.begin() + static_cast<difference_type>(out), nodes_.end());
+            return nodes_.end();
         }
 
         template <template <class Ty> class InserterAllocator, class JsonTree>
         friend class document_tree_parser;
+        friend class document_tree_edit<document_tree>;
     public:
         constexpr document_tree(std::size_t init_cap = 1024, const BufferAllocator& buf_alloc = BufferAllocator{}, const TreeAllocator& tree_alloc = TreeAllocator{})
-        : nodes_(tree_alloc) {
+        : nodes_(tree_alloc), child_index_(tree_alloc) {
             nodes_.reserve(init_cap);
+            child_index_.reserve(init_cap);
             emplace_back_(nullptr, data(), "", node_value{document_node_root_tag, buf_alloc});
         }
+
+        constexpr allocator_type     get_allocator() const noexcept { return nodes_.get_allocator(); }
+
+        // Child index makes child lookups O(1) for 16 extra bytes per node, it is on by default.
+        // Turning it off falls back to binary searches over parent indices.
+        constexpr bool               child_index() const noexcept { return indexed_; }
+        constexpr void               child_index(bool enable) {
+            indexed_ = enable;
+            if (enable) { rebuild_child_index_(); }
+            else { child_index_.clear(); child_index_.shrink_to_fit(); }
+        }
+
+        // Objects with at least threshold children get a hash table of their keys on first lookup by name,
+        // no_key_index (the default) turns it off. Tables are kept in sync by emplace and erase, renaming a node
+        // through name() is not tracked, call invalidate_key_index() afterwards.
+        constexpr std::size_t        key_index_threshold() const noexcept { return key_index_threshold_; }
+        constexpr void               key_index_threshold(std::size_t threshold) { key_index_threshold_ = threshold; clear_key_index_(); }
+        constexpr void               invalidate_key_index() noexcept { clear_key_index_(); }
         
         constexpr std::size_t        size() const noexcept { return nodes_.size(); }
         constexpr pointer            data()       noexcept { return nodes_.data(); }
@@ -507,16 +1856,90 @@ namespace jxxson {
         constexpr decltype(auto)     root()    const { return begin() + 1; }
         constexpr decltype(auto)     root()          { return begin() + 1; }
         
+        // Emplacing below a packed array unpacks it in the same pass, a deferred container is materialized first.
         constexpr iterator       emplace(iterator parent, string_view name, const node_value& value) {
-            return iterator(this, &*emplace_auto_(&*parent, data(), name, value));
+            if (parent->value().packed() || parent->value().deferred()) {
+                document_tree_edit<document_tree> edit(*this);
+                const auto pending = edit.emplace(parent, name, value);
+                apply(edit);
+                return begin() + static_cast<difference_type>(edit.index(pending));
+            }
+            return iterator(this, &*emplace_auto_(&*parent, data(), name, node_value(value, buffer_allocator_())));
+        }
+
+        // Gives a packed array one child node per element, like a parser that does not pack would,
+        // and a deferred container one child node per member (materialize with a depth of 1).
+        // Nodes not deeper than array keep their indices, all other iterators are invalidated.
+        constexpr iterator       unpack(iterator array) {
+            if (!array->value().packed() && !array->value().deferred()) { return array; }
+            const difference_type at = array - begin();
+            document_tree_edit<document_tree> edit(*this);
+            edit.expand_(static_cast<std::size_t>(at));
+            apply(edit);
+            return begin() + at;
+        }
+
+        // Unpacks every packed array of the tree in one pass.
+        constexpr void           unpack_arrays() {
+            document_tree_edit<document_tree> edit(*this);
+            for (std::size_t i = 0; i != size(); ++i) { if (nodes_[i].value().packed()) { edit.expand_(i); } }
+            apply(edit);
+        }
+
+        // Unpacks the packed arrays below node in one pass, node and the nodes not deeper than it keep their indices.
+        constexpr void           unpack_arrays(iterator node) {
+            const std::size_t                 at = static_cast<std::size_t>(node - begin());
+            std::vector<bool>                 below(size(), false);
+            document_tree_edit<document_tree> edit(*this);
+            below[at] = true;
+            for (std::size_t i = at + 1; i < size(); ++i) {
+                if (!(below[i] = below[static_cast<std::size_t>(nodes_[i].parent_index())])) { continue; }
+                if (nodes_[i].value().packed()) { edit.expand_(i); }
+            }
+            apply(edit);
+        }
+
+        // Parses the deferred containers of node and of depth - 1 levels of members below it (its whole subtree by default)
+        // in one pass. Nodes not deeper than node keep their indices, all other iterators are invalidated.
+        constexpr iterator       materialize(iterator node, std::size_t depth = std::numeric_limits<std::size_t>::max()) {
+            if (!node->value().deferred() || depth == 0) { return node; }
+            const difference_type at = node - begin();
+            document_tree_edit<document_tree> edit(*this);
+            edit.expand_(static_cast<std::size_t>(at), depth);
+            apply(edit);
+            return begin() + at;
+        }
+
+        // Materializes every deferred container of the tree in one pass, it is then the tree an eager parse builds.
+        constexpr void           materialize() {
+            if (source_ == nullptr) { return; }
+            document_tree_edit<document_tree> edit(*this);
+            for (std::size_t i = 0; i != size(); ++i) { if (nodes_[i].value().deferred()) { edit.expand_(i, std::numeric_limits<std::size_t>::max()); } }
+            apply(edit);
+        }
+
+        // True if some containers of a lazily parsed tree are not materialized yet.
+        constexpr bool           deferred() const {
+            return source_ != nullptr && std::ranges::any_of(nodes_, [](const value_type& n) { return n.value().deferred(); });
         }
 
+        // The members of a deferred container are not nodes, iterating it throws instead of finding no children.
         constexpr const_iterator search_child_begin(const_iterator parent) const {
+            require_materialized_(parent);
+            if (indexed_) {
+                const auto& range = child_index_[parent - begin()];
+                return const_iterator(this, range.count != 0 ? data() + range.first : data() + size());
+            }
             auto it = std::ranges::upper_bound(nodes_.begin() + (parent - begin()), nodes_.end(), parent - begin() - 1, std::less<difference_type>(), upper_bound_proj);
             return const_iterator(this, it == nodes_.end() || (it->parent_index() != parent - begin()) ? data() + size() : &*it);
         }
 
         constexpr const_iterator search_child_end(const_iterator parent) const {
+            require_materialized_(parent);
+            if (indexed_) {
+                const auto& range = child_index_[parent - begin()];
+                return const_iterator(this, range.count != 0 ? data() + range.first + range.count : data() + size());
+            }
             auto it = std::ranges::upper_bound(nodes_.begin() + (parent - begin()), nodes_.end(), parent - begin(), std::less<difference_type>(), upper_bound_proj);
             return const_iterator(this, it == nodes_.end() || ((it - 1)->parent_index() != parent - begin()) ? data() + size() : &*it);
         }
@@ -527,41 +1950,161 @@ namespace jxxson {
 
         constexpr iterator       erase(iterator from) {
             auto it = erase_all_unknows_(nodes_.begin() + (from - begin()));
+            rebuild_child_index_();
+            clear_key_index_();
             return iterator(this, it != nodes_.end() ? &*it : (data() + size()));
         }
 
+        // Drops every node but the root, capacity is kept so the tree can be parsed into again.
+        constexpr void           clear() {
+            nodes_.erase(nodes_.begin() + 1, nodes_.end());
+            source_.reset();
+            rebuild_child_index_();
+            clear_key_index_();
+        }
+
+        // Merges every pending insert of edit in one breadth first pass, O(size() + edit.size()) instead of one shift per insert.
+        // New children come after the existing children of their parent in the order they were recorded, as if emplaced one by one.
+        // Nodes not deeper than the shallowest edited parent keep their indices, all other iterators are invalidated,
+        // edit.index() tells where a pending node ended up.
+        constexpr void           apply(document_tree_edit<document_tree>& edit) {
+            constexpr std::size_t npos     = std::numeric_limits<std::size_t>::max();
+            auto&                 pending  = edit.nodes_;
+            const std::size_t     old_size = size(), total = old_size + pending.size();
+            // Elements of these arrays and members of these containers are pending nodes now.
+            for (const std::size_t i : edit.unpacked_) {
+                node_value& value = nodes_[i].value();
+                value = value.type == document_tree_node_type::object ? node_value(document_node_object_tag, value.get_allocator()) : node_value(document_node_array_tag, value.get_allocator());
+            }
+            edit.unpacked_.clear();
+            if (pending.empty()) { return; }
+
+            // Pending children of every parent as linked lists in record order, existing parent i is slot i,
+            // pending parent p is slot old_size + p.
+            using size_allocator = typename std::allocator_traits<allocator_type>::template rebind_alloc<std::size_t>;
+            std::vector<std::size_t, size_allocator> first(total, npos, size_allocator(nodes_.get_allocator()));
+            std::vector<std::size_t, size_allocator> last (total, npos, size_allocator(nodes_.get_allocator()));
+            std::vector<std::size_t, size_allocator> next (pending.size(), npos, size_allocator(nodes_.get_allocator()));
+            std::vector<std::size_t, size_allocator> slots(total, npos, size_allocator(nodes_.get_allocator()));
+            for (std::size_t p = 0; p != pending.size(); ++p) {
+                const std::size_t slot = edit.slot_of_(pending[p].parent, old_size);
+                if (first[slot] == npos) { first[slot] = p; } else { next[last[slot]] = p; }
+                last[slot] = p;
+            }
+
+            child_index_type scratch(child_index_.get_allocator());
+            if (!indexed_) { detail::build_child_index(nodes_, scratch); }
+            const child_index_type& ranges = indexed_ ? child_index_ : scratch;
+
+            // Breadth first walk of the merged tree, the output itself is the queue.
+            container merged(nodes_.get_allocator());
+            merged.reserve(total);
+            merged.emplace_back(std::move(nodes_[0]));
+            slots[0] = 0;
+            for (std::size_t i = 0; i != merged.size(); ++i) {
+                const std::size_t slot = slots[i];
+                if (slot < old_size) {
+                    for (std::size_t c = ranges[slot].first, e = c + ranges[slot].count; c != e; ++c) {
+                        slots[merged.size()] = c;
+                        merged.emplace_back(std::move(nodes_[c])).parent_index() = static_cast<difference_type>(i);
+                    }
+                }
+                for (std::size_t p = first[slot]; p != npos; p = next[p]) {
+                    pending[p].index     = merged.size();
+                    slots[merged.size()] = old_size + p;
+                    merged.emplace_back(static_cast<difference_type>(i), std::move(pending[p].name), std::move(pending[p].value));
+                }
+            }
+            nodes_ = std::move(merged);
+            rebuild_child_index_();
+            clear_key_index_();
+        }
+
+        // Mutable lookups materialize the whole subtree of a deferred container they look into or find, so nothing below
+        // what they return is deferred and lookups into it change no indices. Materializing invalidates the iterators
+        // to nodes deeper than the container, the parent given is found again by its index.
         constexpr iterator           insert_or_access(iterator actual_root, string_view name) {
+            actual_root = unpack(materialize(actual_root));
+            if (const key_table* table = acquire_key_table_(actual_root - begin())) {
+                const auto found = lookup_key_(*table, &*actual_root.begin(), name);
+                return found != nullptr ? materialize(iterator(this, const_cast<pointer>(found))) : actual_root.emplace(name, node_value(buffer_allocator_()));
+            }
             auto it = std::ranges::find_if(actual_root.begin(), actual_root.end(), [name](auto& v) { return v.name() == name; });
-            return it == actual_root.end() ? actual_root.emplace(name, {}) : it;
+            return it == actual_root.end() ? actual_root.emplace(name, node_value(buffer_allocator_())) : materialize(it);
         }
 
+        // Mutable access by index unpacks a packed array first, so the elements are nodes that can be changed. To read
+        // one element use element(), to change one in place write through value().as<std::span<double>>() (or int_type).
         constexpr iterator           insert_or_access(iterator actual_root, std::size_t i) {
-            for (std::ptrdiff_t j = 0; j < static_cast<std::ptrdiff_t>(i + 1 - (actual_root.end() - actual_root.begin())); ++j) { actual_root.emplace("", {}); }
-            return (actual_root.begin() + i);
+            // Emplacing may reallocate, the parent is found by index again, children are always inserted behind it.
+            actual_root = unpack(materialize(actual_root));
+            const difference_type at = actual_root - begin();
+            for (std::size_t n = (begin() + at).size(); n <= i; ++n) { (begin() + at).emplace("", node_value(buffer_allocator_())); }
+            return materialize((begin() + at).begin() + static_cast<difference_type>(i));
         }
 
+        // Const lookups only use key tables that are already built. They change nothing, so they cannot materialize and
+        // throw on a deferred container, as its iteration and size() do. Materialize first (or look up through a mutable tree).
         constexpr const_iterator     access(const_iterator actual_root, string_view name) const {
+            if (const key_table* table = find_key_table_(actual_root - begin())) {
+                const auto found = lookup_key_(*table, &*actual_root.begin(), name);
+                return found != nullptr ? const_iterator(this, found) : end();
+            }
             auto it = std::ranges::find_if(actual_root.begin(), actual_root.end(), [name](const auto& v) {
                 return v.name() == name;
             });
             return it == actual_root.end() ? end() : it;
         }
 
+        // Elements of a packed array are not nodes, looking one up throws instead of finding nothing, see element().
         constexpr const_iterator     access(const_iterator actual_root, std::size_t i) const {
+            if (actual_root->value().packed()) { throw std::logic_error("jxxson: elements of a packed array are not nodes, read them with element()"); }
             if (i + 1 > static_cast<std::size_t>(actual_root.end() - actual_root.begin())) { return end(); }
             return actual_root.begin() + i;
         }
 
+        // Element i of an array (or child i of an object) without unpacking anything, elements of a packed array are
+        // read straight from it. Strings are views into the tree, valid until it changes. Empty if there is no such child.
+        constexpr std::optional<value_view> element(const_iterator actual_root, std::size_t i) const {
+            const node_value& array = actual_root->value();
+            if (array.packed_type() == document_tree_node_type::integer) {
+                const auto elements = array.template as<std::span<const int_type>>();
+                return i < elements.size() ? std::optional<value_view>(value_view(elements[i])) : std::nullopt;
+            }
+            if (array.packed_type() == document_tree_node_type::floating_point) {
+                const auto elements = array.template as<std::span<const float_type>>();
+                return i < elements.size() ? std::optional<value_view>(value_view(elements[i])) : std::nullopt;
+            }
+            const auto child = access(actual_root, i);
+            if (child == end()) { return std::nullopt; }
+            const node_value& v = child->value();
+            switch (v.type) {
+            case document_tree_node_type::boolean:        return value_view(v.template as<bool>());
+            case document_tree_node_type::integer:        return value_view(v.template as<int_type>());
+            case document_tree_node_type::floating_point: return v.literal() ? value_view(document_node_number_tag, v.literal_text()) : value_view(v.template as<float_type>());
+            case document_tree_node_type::string:         return value_view(v.template as<string_view>());
+            case document_tree_node_type::array:          return value_view(document_node_array_tag);
+            case document_tree_node_type::object:         return value_view(document_node_object_tag);
+            default:                                      return value_view();
+            }
+        }
+
         constexpr iterator           access(iterator actual_root, string_view name) {
+            actual_root = unpack(materialize(actual_root));
+            if (const key_table* table = acquire_key_table_(actual_root - begin())) {
+                const auto found = lookup_key_(*table, &*actual_root.begin(), name);
+                return found != nullptr ? materialize(iterator(this, const_cast<pointer>(found))) : end();
+            }
             auto it = std::ranges::find_if(actual_root.begin(), actual_root.end(), [name](const auto& v) {
                 return v.name() == name;
             });
-            return it == actual_root.end() ? end() : it;
+            return it == actual_root.end() ? end() : materialize(it);
         }
 
         constexpr iterator           access(iterator actual_root, std::size_t i) {
+            actual_root = unpack(materialize(actual_root));
             if (i + 1 > static_cast<std::size_t>(actual_root.end() - actual_root.begin())) { return end(); }
-            return actual_root.begin() + i;
+            return materialize(actual_root.begin() + i);
         }
 
         constexpr iterator           operator[](std::string_view name)       { return insert_or_access(begin() + 1, name); }
@@ -571,10 +2114,251 @@ namespace jxxson {
         constexpr const_iterator     find(std::string_view name)       const { return access(begin() + 1, name); }
         constexpr const_iterator     find(std::size_t      id)         const { return access(begin() + 1, id); }
         
-        template <class OutputIt>
-        constexpr OutputIt format_to(OutputIt out) const {
-            return format_to_impl(0, begin() + 1, out);  // Not format root.
+        template <std::output_iterator<CharT> OutputIt>
+        constexpr OutputIt format_to(OutputIt out, const format_style& style = format_pretty) const {
+            detail::format_sink<CharT, detail::iterator_flush<CharT, OutputIt>> sink({out});
+            detail::format_tree_to(*this, style, sink);
+            return sink.flush_to.out;
+        }
+
+        template <class Traits>
+        std::basic_ostream<CharT, Traits>& format_to(std::basic_ostream<CharT, Traits>& os, const format_style& style = format_pretty) const {
+            auto flush = [&os](const CharT* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return os;
+        }
+
+        string to_string(const format_style& style = format_pretty) const {
+            string str;
+            auto flush = [&str](const CharT* p, std::size_t n) { str.append(p, n); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return str;
+        }
+
+        // Same output, formatted on up to threads threads, small trees are formatted on the calling thread.
+        template <std::output_iterator<CharT> OutputIt>
+        OutputIt format_to(OutputIt out, const format_style& style, std::size_t threads) const {
+            detail::format_tree_parallel_to(*this, style, threads, [&out](const CharT* p, std::size_t n) { out = std::ranges::copy(p, p + n, out).out; });
+            return out;
+        }
+
+        template <class Traits>
+        std::basic_ostream<CharT, Traits>& format_to(std::basic_ostream<CharT, Traits>& os, const format_style& style, std::size_t threads) const {
+            detail::format_tree_parallel_to(*this, style, threads, [&os](const CharT* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); });
+            return os;
+        }
+
+        string to_string(const format_style& style, std::size_t threads) const {
+            string str;
+            detail::format_tree_parallel_to(*this, style, threads, [&str](const CharT* p, std::size_t n) { str.append(p, n); });
+            return str;
+        }
+    };
+
+    // Inserts recorded against an existing tree, merged at once by document_tree::apply.
+    // Pending nodes can be parents of further inserts, whole subtrees built by a batch inserter can be grafted too.
+    template <class JsonTree>
+    class document_tree_edit {
+    public:
+        using tree_type   = JsonTree;
+        using string_view = typename tree_type::string_view;
+        using node_value  = typename tree_type::node_value;
+        using node_string = typename tree_type::node_string;
+        using iterator    = typename tree_type::iterator;
+
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        // Handle of a pending node, invalid if its parent can not have children.
+        struct pending {
+            std::size_t id = npos;
+            constexpr bool valid() const noexcept { return id != npos; }
+        };
+
+        constexpr explicit document_tree_edit(tree_type& tree) : tree_(&tree), nodes_(tree.get_allocator()), unpacked_(tree.get_allocator()) {}
+
+        constexpr pending emplace(iterator parent, string_view name, const node_value& value) {
+            if (!parent->value().parent_type()) { return {}; }
+            expand_(static_cast<std::size_t>(parent - tree_->begin()));
+            return push_(static_cast<std::size_t>(parent - tree_->begin()), name, node_value(value, tree_->buffer_allocator_()));
+        }
+
+        constexpr pending emplace(pending parent, string_view name, const node_value& value) {
+            if (!parent.valid() || !nodes_[parent.id].value.parent_type()) { return {}; }
+            return push_(parent.id | pending_bit, name, node_value(value, tree_->buffer_allocator_()));
+        }
+
+        // Moves every node of subtree below parent, children of the inserter's root become children of parent.
+        template <class Parent, class Inserter>
+        constexpr void    insert(Parent parent, Inserter& subtree) {
+            const pending graft = graft_(parent);
+            if (!graft.valid()) { return; }
+            for (auto it = std::next(subtree.begin()); it != subtree.end(); ++it) {
+                const std::size_t at = it->parent == subtree.root() ? graft.id : (it->parent->index | pending_bit);
+                it->index = push_(at, std::move(it->name), std::move(it->value)).id;
+            }
+        }
+
+        // Index of a pending node in the tree, valid after apply.
+        constexpr std::size_t index(pending p) const { return nodes_[p.id].index; }
+        constexpr std::size_t size()           const noexcept { return nodes_.size(); }
+        constexpr bool        empty()          const noexcept { return nodes_.empty(); }
+        constexpr void        clear()                noexcept { nodes_.clear(); unpacked_.clear(); }
+    private:
+        friend tree_type;
+
+        // Parents are indices of the tree, or ids of pending nodes with this bit set.
+        static constexpr std::size_t pending_bit = ~(npos >> 1);
+
+        struct pending_node {
+            std::size_t parent;
+            node_string name;
+            node_value  value;
+            std::size_t index = 0;
+        };
+        using allocator = typename std::allocator_traits<typename tree_type::allocator_type>::template rebind_alloc<pending_node>;
+
+        using index_allocator = typename std::allocator_traits<typename tree_type::allocator_type>::template rebind_alloc<std::size_t>;
+
+        tree_type*                                  tree_;
+        std::vector<pending_node, allocator>        nodes_;
+        std::vector<std::size_t, index_allocator>   unpacked_;  // Packed arrays and deferred containers whose children were queued by expand_.
+
+        // First insert below a packed array or a deferred container queues its children ahead of it, apply turns it into a plain one.
+        constexpr void    expand_(std::size_t parent, std::size_t depth = 1) {
+            const node_value& array = (tree_->begin() + static_cast<std::ptrdiff_t>(parent))->value();
+            if ((!array.packed() && !array.deferred()) || std::ranges::find(unpacked_, parent) != unpacked_.end()) { return; }
+            unpacked_.push_back(parent);
+            if (array.deferred()) { return parse_(parent, array.deferred_text(), array.get_allocator(), depth); }
+            auto queue = [&](auto values) { for (const auto v : values) { push_(parent, string_view(), node_value(v, array.get_allocator())); } };
+            if (array.packed_type() == document_tree_node_type::integer) { queue(array.template as<std::span<const typename tree_type::int_type>>()); }
+            else { queue(array.template as<std::span<const typename tree_type::float_type>>()); }
+        }
+
+        // Members of a deferred container as pending nodes, deferred members are parsed below them while depth lasts.
+        constexpr void    parse_(std::size_t parent, string_view text, const auto& alloc, std::size_t depth) {
+            const char* stop = nullptr;
+            detail::parse_deferred_level<node_value>(detail::select_scanner(), text.data(), text.data() + text.size(), alloc, stop, [&](string_view name, node_value&& value) {
+                const string_view nested = depth > 1 ? value.deferred_text() : string_view();
+                const pending     child  = push_(parent, name, std::move(value));
+                if (!nested.empty()) {
+                    node_value& plain = nodes_[child.id].value;
+                    plain = plain.type == document_tree_node_type::object ? node_value(document_node_object_tag, alloc) : node_value(document_node_array_tag, alloc);
+                    parse_(child.id | pending_bit, nested, alloc, depth - 1);
+                }
+            });
         }
+
+        constexpr pending push_(std::size_t parent, string_view name, node_value&& value) {
+            return push_(parent, node_string(name, value.get_allocator()), std::move(value));
+        }
+
+        constexpr pending push_(std::size_t parent, node_string&& name, node_value&& value) {
+            nodes_.push_back(pending_node{parent, std::move(name), std::move(value)});
+            return {nodes_.size() - 1};
+        }
+
+        // Parent of a graft, encoded as emplace would.
+        constexpr pending graft_(iterator parent) {
+            if (!parent->value().parent_type()) { return {}; }
+            expand_(static_cast<std::size_t>(parent - tree_->begin()));
+            return pending{static_cast<std::size_t>(parent - tree_->begin())};
+        }
+
+        constexpr pending graft_(pending parent) const {
+            return parent.valid() && nodes_[parent.id].value.parent_type() ? pending{parent.id | pending_bit} : pending{};
+        }
+
+        static constexpr std::size_t slot_of_(std::size_t parent, std::size_t old_size) {
+            return (parent & pending_bit) != 0 ? old_size + (parent & ~pending_bit) : parent;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                           Memory Mapped Files                               ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Read only contents of a whole file as one contiguous range of char. Regular files are mapped
+    // (and advised for sequential access), anything else, or platforms without mmap, is read into a buffer.
+    // Views parsed from it stay valid as long as the mapped_file lives.
+    class mapped_file {
+        const char*        data_   = nullptr;
+        std::size_t        size_   = 0;
+        bool               mapped_ = false;
+        std::vector<char>  buffer_;
+
+        void unmap_() noexcept {
+#if defined(JXXSON_POSIX_MMAP)
+            if (mapped_) { ::munmap(const_cast<char*>(data_), size_); }
+#endif
+            data_ = nullptr; size_ = 0; mapped_ = false; buffer_.clear();
+        }
+    public:
+        using value_type     = char;
+        using const_iterator = const char*;
+
+        mapped_file() = default;
+
+        explicit mapped_file(const std::filesystem::path& path) {
+#if defined(JXXSON_POSIX_MMAP)
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) { throw std::system_error(errno, std::generic_category(), path.string()); }
+            struct stat st{};
+            if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void* p = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    ::madvise(p, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+                    ::close(fd);
+                    data_ = static_cast<const char*>(p); size_ = static_cast<std::size_t>(st.st_size); mapped_ = true;
+                    return;
+                }
+            }
+            // Pipes, procfs and friends report no size, read until end of file. The buffer grows only when it is full.
+            for (std::size_t used = 0;;) {
+                if (used == buffer_.size()) { buffer_.resize(std::max<std::size_t>(used * 2, 65536)); }
+                const ::ssize_t n = ::read(fd, buffer_.data() + used, buffer_.size() - used);
+                if (n < 0 && errno == EINTR) { continue; }
+                if (n < 0) { const int e = errno; ::close(fd); throw std::system_error(e, std::generic_category(), path.string()); }
+                used += static_cast<std::size_t>(n);
+                if (n == 0) { buffer_.resize(used); break; }
+            }
+            ::close(fd);
+#else
+            std::ifstream in(path, std::ios::binary | std::ios::ate);
+            if (!in) { throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), path.string()); }
+            buffer_.resize(static_cast<std::size_t>(in.tellg()));
+            in.seekg(0).read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+#endif
+            data_ = buffer_.data(); size_ = buffer_.size();
+        }
+
+        mapped_file(const mapped_file&)            = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        mapped_file(mapped_file&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)), mapped_(std::exchange(other.mapped_, false)), buffer_(std::move(other.buffer_)) {}
+
+        mapped_file& operator=(mapped_file&& other) noexcept {
+            if (this != &other) {
+                unmap_();
+                data_   = std::exchange(other.data_, nullptr);
+                size_   = std::exchange(other.size_, 0);
+                mapped_ = std::exchange(other.mapped_, false);
+                buffer_ = std::move(other.buffer_);
+            }
+            return *this;
+        }
+
+        ~mapped_file() { unmap_(); }
+
+        const char*      data()   const noexcept { return data_; }
+        std::size_t      size()   const noexcept { return size_; }
+        bool             empty()  const noexcept { return size_ == 0; }
+        bool             mapped() const noexcept { return mapped_; }
+        const char*      begin()  const noexcept { return data_; }
+        const char*      end()    const noexcept { return data_ + size_; }
+        std::string_view view()   const noexcept { return {data_, size_}; }
     };
 
     template <template <class Ty> class InserterAllocator = std::allocator, class JsonTree = document_tree<>>
@@ -590,6 +2374,9 @@ namespace jxxson {
         using inserter_allocator = typename inserter::container_allocator;
 
         JsonTree& tree;
+        bool      validate_utf8 = false;  // Contiguous input is checked first and parsing stops at the first malformed byte.
+        bool      pack_arrays   = false;  // Non empty arrays of only integers or only floats in contiguous input become packed arrays.
+        bool      lazy          = false;  // Containers below the top level value of contiguous input are deferred until looked into.
 
         template <class InputIt>
         static constexpr InputIt parse_spaces(InputIt beg, InputIt end) {
@@ -597,38 +2384,200 @@ namespace jxxson {
             return beg;
         }
         
+        // Escape sequences are decoded into str, raw holds the string as written while it is read.
         template <class InputIt>
-        static constexpr InputIt parse_name_or_string(bool& is_name, string& str, InputIt beg, InputIt end) {
-            for (;beg != end && *beg != char_type{'\"'}; ++beg) { str.push_back(*beg); } ++beg;
+        static constexpr InputIt parse_name_or_string(bool& is_name, string& str, string& raw, InputIt beg, InputIt end) {
+            bool escaped = false;
+            for (;beg != end && *beg != char_type{'\"'}; ++beg) {
+                if (*beg == char_type{'\\'}) { escaped = true; raw.push_back(*beg); if (++beg == end) { break; } }
+                raw.push_back(*beg);
+            }
+            // An unterminated string runs to the end of input, like in the contiguous parser.
+            if (beg != end) { ++beg; }
+            if (escaped) { detail::unescape_to(str, raw.data(), raw.data() + raw.size()); }
+            else { str.swap(raw); }
+            raw.clear();
             beg = parse_spaces(beg, end);
-            if (*beg == char_type{':'}) { is_name = true; ++beg; }
-            else { is_name = false; } 
+            is_name = beg != end && *beg == char_type{':'};
+            if (is_name) { ++beg; }
             return beg;
         }
 
         template <class InputIt>
-        static constexpr InputIt parse_number(bool& is_float, string& buffer, InputIt beg, InputIt end) {
-            for (;beg != end && (std::isalnum(*beg) || *beg == char_type{'.'} || *beg == char_type{'+'} || *beg == char_type{'-'}); ++beg) {
-                if (*beg == char_type{'.'} || *beg == char_type{'e'} || *beg == char_type{'E'}) {
-                    is_float = true;
-                }
-                buffer.push_back(*beg);
-            }
+        static constexpr InputIt parse_number(string& buffer, InputIt beg, InputIt end) {
+            for (;beg != end && detail::is_number_char(*beg); ++beg) { buffer.push_back(*beg); }
             return beg;
         }
 
         template <typename Ty>
         static constexpr auto   emplace_value(inserter& inserter, typename inserter::container_iterator current, typename inserter::container_iterator current_parent, Ty&& value) {
             if (current_parent->value.type == document_tree_node_type::array) {
-                current = inserter.emplace(current_parent, string_view(), std::forward<Ty>(value));
+                const auto sa = value.get_allocator();
+                current = inserter.emplace(current_parent, string_view(), std::forward<Ty>(value), sa);
             } else { current->value = std::forward<Ty>(value); }
             return current;
         }
 
         template <class InputIt>
         constexpr InputIt operator()(InputIt beg, InputIt end, const typename string::allocator_type& sa = typename string::allocator_type{},  const inserter_allocator& ia = inserter_allocator{}) {
-            string                                   buffer; buffer.reserve(2048);
-            inserter                                 inserter{sa, ia};
+            inserter inserter{sa, ia};
+            beg = parse_depth_first(inserter, beg, end, sa);
+            relayout_breadth_first(inserter, ia);
+            return beg;
+        }
+
+        // Contiguous input of narrow characters is parsed with the block scanners instead of character by character.
+        template <std::contiguous_iterator InputIt>
+        requires (std::is_same_v<std::iter_value_t<InputIt>, char_type> && sizeof(char_type) == 1)
+        constexpr InputIt operator()(InputIt beg, InputIt end, const typename string::allocator_type& sa = typename string::allocator_type{},  const inserter_allocator& ia = inserter_allocator{}) {
+            inserter inserter{sa, ia};
+            const char_type* first = std::to_address(beg);
+            const char_type* last  = first + (end - beg);
+            if (validate_utf8) { last = detail::find_invalid_utf8(detail::select_scanner(), first, last); }
+            if (const char_type* stop = lazy ? parse_lazy(first, last, sa) : nullptr) { return beg + (stop - first); }
+            last = parse_depth_first(inserter, first, last, sa, pack_arrays);
+            relayout_breadth_first(inserter, ia);
+            return beg + (last - first);
+        }
+
+        template <std::ranges::contiguous_range Range>
+        requires (std::is_same_v<std::ranges::range_value_t<Range>, char_type> && sizeof(char_type) == 1)
+        constexpr auto operator()(const Range& input, const typename string::allocator_type& sa = typename string::allocator_type{},  const inserter_allocator& ia = inserter_allocator{}) {
+            return (*this)(std::ranges::begin(input), std::ranges::end(input), sa, ia);
+        }
+
+        // Tree owns copies of everything, so the file is unmapped again once parsed.
+        // Returns the offset where parsing stopped, it equals the file size if the whole file was consumed.
+        std::size_t load_file(const std::filesystem::path& path, const typename string::allocator_type& sa = typename string::allocator_type{},  const inserter_allocator& ia = inserter_allocator{}) {
+            const mapped_file file(path);
+            return static_cast<std::size_t>((*this)(file.begin(), file.end(), sa, ia) - file.begin());
+        }
+
+        // Splits large input at commas found by a structural pre-scan and parses the parts on threads, each into its own
+        // inserter that starts with placeholders for the containers open at its split point. Nodes of every depth keep
+        // document order across parts, so the counting sort of relayout_breadth_first works on all parts at once and gives
+        // the same tree as a serial parse. Input smaller than min_part bytes per thread, input the parts do not agree on
+        // (it is not valid json) and trees with stateful string allocators (an arena is not thread safe) are parsed serially.
+        // A part stops at a closer of a container it did not see open nor got a placeholder for, so unbalanced input fails the
+        // stop check below before any node is merged.
+        template <std::contiguous_iterator InputIt>
+        requires (std::is_same_v<std::iter_value_t<InputIt>, char_type> && sizeof(char_type) == 1)
+        InputIt parse_parallel(InputIt beg, InputIt end, std::size_t threads, const typename string::allocator_type& sa = typename string::allocator_type{},
+                               std::size_t min_part = std::size_t{1} << 20) {
+            using node_iterator = typename inserter::container_iterator;
+            if constexpr (!std::allocator_traits<typename string::allocator_type>::is_always_equal::value) { return (*this)(beg, end, sa); }
+            if (lazy) { return (*this)(beg, end, sa); }
+            const char_type*  first = std::to_address(beg);
+            const char_type*  last  = validate_utf8 ? detail::find_invalid_utf8(detail::select_scanner(), first, first + (end - beg)) : first + (end - beg);
+            const std::size_t parts = std::min(threads, static_cast<std::size_t>(last - first) / std::max<std::size_t>(min_part, 1));
+            const auto        splits = parts > 1 ? detail::find_split_points(detail::select_scanner(), first, last, parts) : std::vector<detail::split_point>{};
+            if (splits.empty()) { return (*this)(beg, end, sa); }
+
+            // Part k > 0 begins with one placeholder per open container, chained below its root.
+            struct part {
+                inserter                   nodes;
+                const char_type*           beg;
+                const char_type*           end;
+                const char_type*           stop;
+                std::vector<node_iterator> holders;
+                std::vector<node_iterator> open;      // Containers still open at the end of the part, outermost first.
+                std::vector<std::size_t>   level;     // Real nodes per depth, then index of the next one.
+            };
+            const std::size_t n = splits.size() + 1;
+            std::vector<part> chunks;
+            chunks.reserve(n);
+            for (std::size_t k = 0; k != n; ++k) {
+                chunks.push_back(part{inserter{sa}, k == 0 ? first : splits[k - 1].pos, k + 1 == n ? last : splits[k].pos, nullptr, {}, {}, {}});
+            }
+            detail::parallel_for(n, [&](std::size_t k) {
+                part&         p      = chunks[k];
+                node_iterator parent = p.nodes.root();
+                if (k != 0) {
+                    for (const bool is_object : splits[k - 1].open) {
+                        parent = is_object ? p.nodes.emplace(parent, string_view(), node_value(document_node_object_tag, sa), sa) :
+                                             p.nodes.emplace(parent, string_view(), node_value(document_node_array_tag, sa), sa);
+                        p.holders.push_back(parent);
+                    }
+                }
+                p.stop = parse_depth_first(p.nodes, parent, p.beg, p.end, sa, pack_arrays);
+                for (;parent != p.nodes.root(); parent = parent->parent) { p.open.push_back(parent); }
+                std::ranges::reverse(p.open);
+                p.level.assign(p.nodes.depth() + 1, 0);
+                auto it = std::next(p.nodes.begin(), static_cast<std::ptrdiff_t>(p.holders.size() + 1));
+                for (;it != p.nodes.end(); ++it) { ++p.level[it->depth]; }
+            });
+            for (std::size_t k = 0; k != n; ++k) {
+                if (chunks[k].stop != chunks[k].end || (k + 1 != n && chunks[k].open.size() != splits[k].open.size())) { return (*this)(beg, end, sa); }
+            }
+
+            // Depth d of part k starts after all shallower nodes and after depth d of the parts before it.
+            std::size_t max_depth = 0;
+            for (const auto& p : chunks) { max_depth = std::max(max_depth, p.level.size()); }
+            std::size_t total = 1;
+            for (std::size_t d = 1; d < max_depth; ++d) {
+                for (auto& p : chunks) {
+                    if (d < p.level.size()) { const std::size_t c = p.level[d]; p.level[d] = total; total += c; }
+                }
+            }
+            detail::parallel_for(n, [&](std::size_t k) {
+                part& p = chunks[k];
+                p.nodes.root()->index = 0;
+                auto it = std::next(p.nodes.begin(), static_cast<std::ptrdiff_t>(p.holders.size() + 1));
+                for (;it != p.nodes.end(); ++it) { it->index = p.level[it->depth]++; }
+            });
+            for (std::size_t k = 1; k != n; ++k) {
+                for (std::size_t j = 0; j != chunks[k].holders.size(); ++j) { chunks[k].holders[j]->index = chunks[k - 1].open[j]->index; }
+            }
+
+            // Root of every part is dropped, tree keeps its own root node.
+            tree.nodes_.erase(tree.nodes_.begin() + 1, tree.nodes_.end());
+            tree.source_.reset();
+            tree.nodes_.resize(total);
+            detail::parallel_for(n, [&](std::size_t k) {
+                part& p = chunks[k];
+                auto it = std::next(p.nodes.begin(), static_cast<std::ptrdiff_t>(p.holders.size() + 1));
+                for (;it != p.nodes.end(); ++it) {
+                    tree.nodes_[it->index] = typename JsonTree::value_type(static_cast<std::ptrdiff_t>(it->parent->index), std::move(it->name), std::move(it->value));
+                }
+            });
+            tree.rebuild_child_index_();
+            tree.clear_key_index_();
+            return beg + (last - first);
+        }
+
+        template <std::ranges::contiguous_range Range>
+        requires (std::is_same_v<std::ranges::range_value_t<Range>, char_type> && sizeof(char_type) == 1)
+        auto parse_parallel(const Range& input, std::size_t threads, const typename string::allocator_type& sa = typename string::allocator_type{}) {
+            return parse_parallel(std::ranges::begin(input), std::ranges::end(input), threads, sa);
+        }
+
+        // The input is copied into the tree, members of the top level value become nodes and its containers deferred values
+        // pointing into the copy. The structural scan that finds the end of a container is all the work done for it.
+        // Returns where parsing stopped, nullptr if the top level value is not a container (the input is then parsed eagerly).
+        template <class Ty = char_type> requires (sizeof(Ty) == 1)
+        constexpr const char_type* parse_lazy(const char_type* first, const char_type* last, const typename string::allocator_type& sa) {
+            const detail::scan_kernels scan = detail::select_scanner();
+            const char_type*           beg  = scan.skip_spaces(first, last);
+            if (beg == last || (*beg != '{' && *beg != '[')) { return nullptr; }
+            auto             source = std::allocate_shared<string>(sa, string(beg, last, sa));
+            const char_type* text   = source->data();
+            const char_type* stop   = nullptr;
+            tree.nodes_.erase(tree.nodes_.begin() + 1, tree.nodes_.end());
+            tree.nodes_.emplace_back(0, string_view(), *beg == '{' ? node_value(document_node_object_tag, sa) : node_value(document_node_array_tag, sa));
+            const bool complete = detail::parse_deferred_level<node_value>(scan, text, text + source->size(), sa, stop, [this](string_view name, node_value&& value) {
+                tree.nodes_.emplace_back(1, name, std::move(value));
+            });
+            tree.source_ = std::move(source);
+            tree.rebuild_child_index_();
+            tree.clear_key_index_();
+            return complete ? scan.skip_spaces(beg + (stop - text), last) : beg + (stop - text);
+        }
+
+        // First stage: tokenize input into a depth first tree, nodes are stored in document order.
+        template <class InputIt>
+        static constexpr InputIt parse_depth_first(inserter& inserter, InputIt beg, InputIt end, const typename string::allocator_type& sa = typename string::allocator_type{}) {
+            string                                   buffer(sa); buffer.reserve(2048);
+            string                                   raw(sa);    raw.reserve(2048);
             typename inserter::container_iterator    current = inserter.root(), current_parent = inserter.root();
             for (;beg != end;) {
                 switch (*beg) {
@@ -636,8 +2585,8 @@ namespace jxxson {
                 case char_type{' '}: case char_type{'\n'}: case char_type{'\t'}: case char_type{'\r'}: beg = parse_spaces(beg, end); break;
                 case char_type{'\"'}: {
                     bool is_name = false; ++beg;
-                    beg = parse_name_or_string(is_name, buffer, beg, end);
-                    current = is_name ? inserter.emplace(current_parent, buffer, {}, sa) : emplace_value(inserter, current, current_parent,  node_value(buffer, sa));
+                    beg = parse_name_or_string(is_name, buffer, raw, beg, end);
+                    current = is_name ? inserter.emplace(current_parent, buffer, node_value(sa), sa) : emplace_value(inserter, current, current_parent,  node_value(buffer, sa));
                     buffer.clear();
                 } break;
                 case char_type{'{'}: {
@@ -651,23 +2600,18 @@ namespace jxxson {
                     current_parent = current; ++beg;
                 } break;
                 case char_type{'}'}: case char_type{']'}:{
+                    if (current_parent == inserter.root()) { return beg; }  // Closes nothing that is open.
                     current = current_parent;
                     current_parent = current_parent->parent; ++beg;
                 } break;
                 case char_type{'0'}: case char_type{'1'}: case char_type{'2'}: case char_type{'3'}: case char_type{'4'}:
                 case char_type{'5'}: case char_type{'6'}: case char_type{'7'}: case char_type{'8'}: case char_type{'9'}:
                 case char_type{'-'}: {
-                    bool is_float = false;
-                    beg = parse_number(is_float, buffer, beg, end);
-                    if (is_float) {
-                        float_type f;
-                        std::from_chars(buffer.data(), buffer.data() + buffer.size(), f, std::chars_format::general);
-                        emplace_value(inserter, current, current_parent, node_value(f, sa));
-                    } else {
-                        int_type i;
-                        std::from_chars(buffer.data(), buffer.data() + buffer.size(), i, 10);
-                        emplace_value(inserter, current, current_parent, node_value(i, sa));
-                    }
+                    beg = parse_number(buffer, beg, end);
+                    detail::number_value<int_type, float_type> num;
+                    if (detail::parse_number(buffer.data(), buffer.data() + buffer.size(), num) != buffer.data() + buffer.size()) { return beg; }
+                    emplace_value(inserter, current, current_parent, num.literal ? node_value(document_node_number_tag, string_view(buffer), sa)
+                                                                     : num.is_float ? node_value(num.f, sa) : node_value(num.i, sa));
                     buffer.clear();
                 } break;
                 case char_type{'t'}: {
@@ -688,22 +2632,2055 @@ namespace jxxson {
                     ++beg; if (*beg != char_type{'l'}) { break; }
                     ++beg; if (*beg != char_type{'l'}) { break; } ++beg;
                     emplace_value(inserter, current, current_parent, node_value(sa));
-                }
+                } break;
                 case char_type{','}: ++beg; break;
                 }
             }
-            // Copy data from depth first tree to breadth first tree.
-            tree.nodes_.resize(inserter.size());
-            std::size_t counter = 1;
-            for (std::size_t i = 1; i != inserter.depth() + 1; ++i) {
-                auto layer = inserter | std::views::filter([i](auto& node) { return node.depth == i; });
-                for (auto& j : layer) {
-                    j.index = counter;
-                    std::construct_at(&tree.nodes_[counter], j.parent->index, j.name, j.value);
-                    ++counter;
+            return beg;
+        }
+
+        template <class Ty = char_type> requires (sizeof(Ty) == 1)
+        static constexpr const char_type* parse_depth_first(inserter& inserter, const char_type* beg, const char_type* end, const typename string::allocator_type& sa = typename string::allocator_type{},
+                                                            bool pack_arrays = false) {
+            typename inserter::container_iterator parent = inserter.root();
+            return parse_depth_first(inserter, parent, beg, end, sa, pack_arrays);
+        }
+
+        // Starts below current_parent instead of the root and leaves the innermost open container in it.
+        // Arrays split between two parts of parse_parallel are not packed, their elements are not all in one part.
+        template <class Ty = char_type> requires (sizeof(Ty) == 1)
+        static constexpr const char_type* parse_depth_first(inserter& inserter, typename inserter::container_iterator& current_parent, const char_type* beg, const char_type* end,
+                                                            const typename string::allocator_type& sa = typename string::allocator_type{}, bool pack_arrays = false) {
+            using int_allocator   = typename std::allocator_traits<typename string::allocator_type>::template rebind_alloc<int_type>;
+            using float_allocator = typename std::allocator_traits<typename string::allocator_type>::template rebind_alloc<float_type>;
+            const detail::scan_kernels                   scan = detail::select_scanner();
+            typename inserter::container_iterator        current = current_parent;
+            string                                       decoded(sa);
+            std::vector<int_type,   int_allocator>       ints((int_allocator(sa)));
+            std::vector<float_type, float_allocator>     floats((float_allocator(sa)));
+            for (;beg != end;) {
+                switch (*beg) {
+                default: return beg;
+                case ' ': case '\n': case '\t': case '\r': beg = scan.skip_spaces(beg, end); break;
+                case '\"': {
+                    // Strings without escapes are emplaced straight from input, the others are decoded first.
+                    bool             escaped = false;
+                    const char_type* str_end = detail::find_string_close(scan, ++beg, end, escaped);
+                    string_view      str(beg, str_end - beg);
+                    if (escaped) { decoded.clear(); detail::unescape_to(decoded, beg, str_end); str = decoded; }
+                    beg = scan.skip_spaces(str_end == end ? end : str_end + 1, end);
+                    if (beg != end && *beg == ':') {
+                        current = inserter.emplace(current_parent, str, node_value(sa), sa); ++beg;
+                    } else { current = emplace_value(inserter, current, current_parent, node_value(str, sa)); }
+                } break;
+                case '{': {
+                    current = current->name.empty() ?  inserter.emplace(current_parent, "", document_node_object_tag, sa) :
+                    emplace_value(inserter, current, current_parent, node_value(document_node_object_tag, sa));
+                    current_parent = current; ++beg;
+                } break;
+                case '[': {
+                    current = current->name.empty() ?  inserter.emplace(current_parent, "", document_node_array_tag, sa) :
+                    emplace_value(inserter, current, current_parent, node_value(document_node_array_tag, sa));
+                    ++beg;
+                    // An array that turns out not to be packable is read again element by element.
+                    if (const char_type* close = pack_arrays ? detail::parse_packed_array(scan, beg, end, ints, floats) : nullptr) {
+                        current->value = floats.empty() ? node_value(std::span<const int_type>(ints), sa) : node_value(std::span<const float_type>(floats), sa);
+                        beg = close;
+                    } else { current_parent = current; }
+                } break;
+                case '}': case ']': {
+                    if (current_parent == inserter.root()) { return beg; }  // Closes nothing that is open.
+                    current = current_parent;
+                    current_parent = current_parent->parent; ++beg;
+                } break;
+                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-': {
+                    // Numbers are converted in place, there is no copy into buffer.
+                    detail::number_value<int_type, float_type> num;
+                    const char_type* num_end = detail::parse_number(beg, end, num);
+                    if (num_end == nullptr) { return beg; }
+                    emplace_value(inserter, current, current_parent, num.literal ? node_value(document_node_number_tag, string_view(beg, num_end), sa)
+                                                                     : num.is_float ? node_value(num.f, sa) : node_value(num.i, sa));
+                    beg = num_end;
+                } break;
+                case 't': {
+                    if (!detail::match_literal(beg, end, "true")) { return beg; }
+                    emplace_value(inserter, current, current_parent, node_value(true, sa)); beg += 4;
+                } break;
+                case 'f': {
+                    if (!detail::match_literal(beg, end, "false")) { return beg; }
+                    emplace_value(inserter, current, current_parent, node_value(false, sa)); beg += 5;
+                } break;
+                case 'n': {
+                    if (!detail::match_literal(beg, end, "null")) { return beg; }
+                    emplace_value(inserter, current, current_parent, node_value(sa)); beg += 4;
+                } break;
+                case ',': ++beg; break;
+                }
+            }
+            return beg;
+        }
+
+        // Second stage: move nodes from depth first tree to breadth first tree.
+        // Nodes of the same depth keep their document order, which is exactly the order of BFVT,
+        // so a counting sort by depth gives every node its final index in one linear pass.
+        constexpr void relayout_breadth_first(inserter& inserter, const inserter_allocator& ia = inserter_allocator{}) {
+            using node_iterator = typename inserter::container_iterator;
+            std::vector<std::size_t, InserterAllocator<std::size_t>> level(inserter.depth() + 2, 0, InserterAllocator<std::size_t>(ia));
+            for (auto& j : inserter) { ++level[j.depth + 1]; }
+            for (std::size_t i = 1; i != level.size(); ++i) { level[i] += level[i - 1]; }
+            // Root of inserter is dropped, tree keeps its own root node.
+            tree.nodes_.erase(tree.nodes_.begin() + 1, tree.nodes_.end());
+            tree.source_.reset();
+            if constexpr (std::allocator_traits<typename string::allocator_type>::is_always_equal::value) {
+                // Nodes move in document order straight to their index, so the inserter is walked in memory order
+                // and every depth is written front to back.
+                tree.nodes_.resize(inserter.size());
+                for (auto it = inserter.begin(); it != inserter.end(); ++it) {
+                    it->index = level[it->depth]++;
+                    if (it->index != 0) { tree.nodes_[it->index] = typename JsonTree::value_type(static_cast<std::ptrdiff_t>(it->parent->index), std::move(it->name), std::move(it->value)); }
+                }
+            } else {
+                // Default constructed nodes would not hold a stateful allocator, they are appended in index order instead.
+                std::vector<node_iterator, InserterAllocator<node_iterator>> order(inserter.size(), InserterAllocator<node_iterator>(ia));
+                for (auto it = inserter.begin(); it != inserter.end(); ++it) {
+                    it->index = level[it->depth]++;
+                    order[it->index] = it;
+                }
+                tree.nodes_.reserve(inserter.size());
+                for (std::size_t i = 1; i != order.size(); ++i) {
+                    tree.nodes_.emplace_back(static_cast<std::ptrdiff_t>(order[i]->parent->index), std::move(order[i]->name), std::move(order[i]->value));
+                }
+            }
+            tree.rebuild_child_index_();
+            tree.clear_key_index_();
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                           Zero Copy Tree View                               ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Value of a document_tree_view node, strings are views so nothing is allocated for them.
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+    class document_node_value_view {
+    public:
+        using string_view         = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using int_type            = Integer;
+        using float_type          = FloatingPoint;
+
+        document_tree_node_type type = document_tree_node_type::null;
+    private:
+        bool        literal_ = false;
+        union {
+            bool        b_;
+            int_type    i_;
+            float_type  f_;
+            string_view s_ = string_view();
+        };
+    public:
+        constexpr document_node_value_view()                        : type(document_tree_node_type::null) {}
+        constexpr document_node_value_view(const bool           b) : type(document_tree_node_type::boolean),        b_(b) {}
+        constexpr document_node_value_view(const int_type       i) : type(document_tree_node_type::integer),        i_(i) {}
+        constexpr document_node_value_view(const float_type     f) : type(document_tree_node_type::floating_point), f_(f) {}
+        constexpr document_node_value_view(const string_view    s) : type(document_tree_node_type::string),         s_(s) {}
+
+        constexpr document_node_value_view(const decltype(document_node_root_tag))   : type(document_tree_node_type::root)   {}
+        constexpr document_node_value_view(const decltype(document_node_array_tag))  : type(document_tree_node_type::array)  {}
+        constexpr document_node_value_view(const decltype(document_node_object_tag)) : type(document_tree_node_type::object) {}
+        constexpr document_node_value_view(const decltype(document_node_number_tag), const string_view text)
+            : type(document_tree_node_type::floating_point), literal_(true), s_(text) {}
+
+        template <typename Ty> constexpr Ty as() const {
+            if constexpr (std::is_same_v<Ty, bool>)            { return b_; }
+            else if constexpr (std::is_same_v<Ty, int_type>)   { return i_; }
+            else if constexpr (std::is_same_v<Ty, float_type>) { return literal_ ? detail::literal_value<float_type>(s_) : f_; }
+            else { return s_; }
+        }
+
+        constexpr bool        literal()      const noexcept { return literal_; }
+        constexpr string_view literal_text() const noexcept { return literal_ ? s_ : string_view(); }
+
+        constexpr bool parent_type()   const { return type == document_tree_node_type::object || type == document_tree_node_type::array || type == document_tree_node_type::root; }
+
+        template <bool IsBegin, class OutputIt>
+        constexpr OutputIt format_to(OutputIt out) const {
+            detail::format_sink<CharT, detail::iterator_flush<CharT, OutputIt>, 64> sink({out});
+            detail::write_value<IsBegin>(*this, sink);
+            sink.flush();
+            return sink.flush_to.out;
+        }
+    };
+
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+    class document_tree_view_node {
+    public:
+        using string_view         = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using int_type            = Integer;
+        using float_type          = FloatingPoint;
+        using value_type          = document_node_value_view<int_type, float_type, CharT>;
+    private:
+        string_view       name_;
+        value_type        value_;
+        std::ptrdiff_t    pid_ = -1;
+    public:
+        constexpr document_tree_view_node(std::ptrdiff_t pid, string_view n, value_type v)
+            : name_(n), value_(v), pid_(pid) {}
+        constexpr document_tree_view_node() = default;
+
+        constexpr string_view       name()            const { return name_; }
+        constexpr const value_type& value()           const { return value_; }
+        constexpr std::ptrdiff_t    parent_index()    const { return pid_; }
+    };
+
+    // Read only BFVT whose names and strings borrow from the parsed input, only strings with escapes are decoded into
+    // storage owned by the view. The input buffer must outlive the view and must not be modified.
+    template <typename Integer         = int,
+              typename FloatingPoint   = double,
+              class    CharT           = char,
+              class    TreeAllocator   = std::allocator<document_tree_view_node<Integer, FloatingPoint, CharT>>
+    >
+    class document_tree_view {
+    public:
+        using string_view       = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using node_value        = document_node_value_view<Integer, FloatingPoint, CharT>;
+        using float_type        = FloatingPoint;
+        using int_type          = Integer;
+
+        using allocator_type    = TreeAllocator;
+        using value_type        = document_tree_view_node<Integer, FloatingPoint, CharT>;
+        using reference         = const value_type&;
+        using const_reference   = const value_type&;
+        using pointer           = const value_type*;
+        using const_pointer     = const value_type*;
+        using difference_type   = std::ptrdiff_t;
+
+        using container                        = std::vector<value_type, allocator_type>;
+        using container_iterator               = typename container::const_iterator;
+        using container_const_iterator         = typename container::const_iterator;
+
+        using iterator               = document_tree_node_const_iterator<document_tree_view>;
+        using const_iterator         = document_tree_node_const_iterator<document_tree_view>;
+
+    protected:
+        using unescaped_string = std::basic_string<CharT, std::char_traits<CharT>, typename std::allocator_traits<TreeAllocator>::template rebind_alloc<CharT>>;
+
+        using child_index_type = std::vector<document_tree_child_range, typename std::allocator_traits<TreeAllocator>::template rebind_alloc<document_tree_child_range>>;
+
+        container                          nodes_;
+        child_index_type                   child_index_;
+        std::forward_list<unescaped_string> unescaped_;
+
+        template <template <class Ty> class InserterAllocator, class JsonTreeView>
+        friend class document_tree_view_parser;
+    public:
+        constexpr document_tree_view(std::size_t init_cap = 1024, const TreeAllocator& tree_alloc = TreeAllocator{})
+        : nodes_(tree_alloc), child_index_(1, document_tree_child_range{}, tree_alloc) {
+            nodes_.reserve(init_cap);
+            nodes_.emplace_back(-1, string_view(), node_value{document_node_root_tag});
+        }
+
+        // Decoded strings are referenced by nodes, so a copy would point into the storage of its source.
+        constexpr document_tree_view(const document_tree_view&)            = delete;
+        constexpr document_tree_view& operator=(const document_tree_view&) = delete;
+        constexpr document_tree_view(document_tree_view&&)                 = default;
+        constexpr document_tree_view& operator=(document_tree_view&&)      = default;
+
+        constexpr std::size_t        size() const noexcept { return nodes_.size(); }
+        constexpr const_pointer      data() const noexcept { return nodes_.data(); }
+        constexpr const_iterator     begin()   const { return const_iterator(this, data());                   }
+        constexpr const_iterator     end()     const { return const_iterator(this, data() + size());          }
+        constexpr const_iterator     root()    const { return begin() + 1; }
+
+        // Drops every node but the root and every decoded string, capacity is kept so the view can be parsed into again.
+        constexpr void               clear() {
+            nodes_.erase(nodes_.begin() + 1, nodes_.end());
+            detail::build_child_index(nodes_, child_index_);
+            unescaped_.clear();
+        }
+
+        // A view never changes after parsing, so its child index is always built.
+        constexpr const_iterator search_child_begin(const_iterator parent) const {
+            const auto& range = child_index_[parent - begin()];
+            return const_iterator(this, range.count != 0 ? data() + range.first : data() + size());
+        }
+
+        constexpr const_iterator search_child_end(const_iterator parent) const {
+            const auto& range = child_index_[parent - begin()];
+            return const_iterator(this, range.count != 0 ? data() + range.first + range.count : data() + size());
+        }
+
+        constexpr const_iterator     access(const_iterator actual_root, string_view name) const {
+            auto it = std::ranges::find_if(actual_root.begin(), actual_root.end(), [name](const auto& v) {
+                return v.name() == name;
+            });
+            return it == actual_root.end() ? end() : it;
+        }
+
+        constexpr const_iterator     access(const_iterator actual_root, std::size_t i) const {
+            if (i + 1 > static_cast<std::size_t>(actual_root.end() - actual_root.begin())) { return end(); }
+            return actual_root.begin() + i;
+        }
+
+        constexpr const_iterator     operator[](string_view name)       const { return access(begin() + 1, name); }
+        constexpr const_iterator     operator[](std::size_t id)         const { return access(begin() + 1, id); }
+        constexpr const_iterator     find(string_view name)             const { return access(begin() + 1, name); }
+        constexpr const_iterator     find(std::size_t id)               const { return access(begin() + 1, id); }
+
+        template <std::output_iterator<CharT> OutputIt>
+        constexpr OutputIt format_to(OutputIt out, const format_style& style = format_pretty) const {
+            detail::format_sink<CharT, detail::iterator_flush<CharT, OutputIt>> sink({out});
+            detail::format_tree_to(*this, style, sink);
+            return sink.flush_to.out;
+        }
+
+        template <class Traits>
+        std::basic_ostream<CharT, Traits>& format_to(std::basic_ostream<CharT, Traits>& os, const format_style& style = format_pretty) const {
+            auto flush = [&os](const CharT* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return os;
+        }
+
+        std::basic_string<CharT> to_string(const format_style& style = format_pretty) const {
+            std::basic_string<CharT> str;
+            auto flush = [&str](const CharT* p, std::size_t n) { str.append(p, n); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return str;
+        }
+
+        // Same output, formatted on up to threads threads, small trees are formatted on the calling thread.
+        template <std::output_iterator<CharT> OutputIt>
+        OutputIt format_to(OutputIt out, const format_style& style, std::size_t threads) const {
+            detail::format_tree_parallel_to(*this, style, threads, [&out](const CharT* p, std::size_t n) { out = std::ranges::copy(p, p + n, out).out; });
+            return out;
+        }
+
+        template <class Traits>
+        std::basic_ostream<CharT, Traits>& format_to(std::basic_ostream<CharT, Traits>& os, const format_style& style, std::size_t threads) const {
+            detail::format_tree_parallel_to(*this, style, threads, [&os](const CharT* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); });
+            return os;
+        }
+
+        std::basic_string<CharT> to_string(const format_style& style, std::size_t threads) const {
+            std::basic_string<CharT> str;
+            detail::format_tree_parallel_to(*this, style, threads, [&str](const CharT* p, std::size_t n) { str.append(p, n); });
+            return str;
+        }
+    };
+
+    template <template <class Ty> class InserterAllocator = std::allocator, class JsonTreeView = document_tree_view<>>
+    class document_tree_view_parser {
+    public:
+        using int_type           = typename JsonTreeView::int_type;
+        using float_type         = typename JsonTreeView::float_type;
+        using string_view        = typename JsonTreeView::string_view;
+        using char_type          = typename string_view::value_type;
+        using node_value         = typename JsonTreeView::node_value;
+        using node_type          = typename JsonTreeView::value_type;
+
+        static_assert(sizeof(char_type) == 1, "document_tree_view only borrows from narrow character input.");
+
+        JsonTreeView& tree;
+        bool          validate_utf8 = false;  // Input is checked first and parsing stops at the first malformed byte.
+
+        // Depth first node, parent is an index into the depth first list.
+        struct inserter_node {
+            std::size_t depth;
+            std::size_t parent;
+            string_view name;
+            node_value  value;
+            std::size_t index = 0;
+        };
+        using inserter           = std::vector<inserter_node, InserterAllocator<inserter_node>>;
+        using inserter_allocator = InserterAllocator<inserter_node>;
+
+        template <std::ranges::contiguous_range Range>
+        requires (std::is_same_v<std::ranges::range_value_t<Range>, char_type>)
+        constexpr auto operator()(const Range& input, const inserter_allocator& ia = inserter_allocator{}) {
+            return (*this)(std::ranges::data(input), std::ranges::data(input) + std::ranges::size(input), ia);
+        }
+
+        constexpr const char_type* operator()(const char_type* beg, const char_type* end, const inserter_allocator& ia = inserter_allocator{}) {
+            inserter    nodes(ia);
+            std::size_t max_depth = 0;
+            tree.unescaped_.clear();
+            if (validate_utf8) { end = detail::find_invalid_utf8(detail::select_scanner(), beg, end); }
+            nodes.reserve(static_cast<std::size_t>(end - beg) / 8 + 1);
+            nodes.push_back(inserter_node{0, 0, string_view(), node_value(document_node_root_tag)});
+            beg = parse_depth_first(nodes, max_depth, beg, end);
+            relayout_breadth_first(nodes, max_depth, ia);
+            return beg;
+        }
+    private:
+        constexpr string_view  make_string(const char_type* beg, const char_type* end, bool escaped) {
+            if (!escaped) { return string_view(beg, end - beg); }
+            auto& str = tree.unescaped_.emplace_front(tree.nodes_.get_allocator());
+            detail::unescape_to(str, beg, end);
+            return str;
+        }
+
+        constexpr std::size_t  emplace(inserter& nodes, std::size_t& max_depth, std::size_t parent, string_view name, node_value value) {
+            const std::size_t depth = nodes[parent].depth + 1;
+            max_depth = std::max(max_depth, depth);
+            nodes.push_back(inserter_node{depth, parent, name, value});
+            return nodes.size() - 1;
+        }
+
+        constexpr std::size_t  emplace_value(inserter& nodes, std::size_t& max_depth, std::size_t current, std::size_t current_parent, node_value value) {
+            if (nodes[current_parent].value.type == document_tree_node_type::array) {
+                current = emplace(nodes, max_depth, current_parent, string_view(), value);
+            } else { nodes[current].value = value; }
+            return current;
+        }
+
+        constexpr const char_type* parse_depth_first(inserter& nodes, std::size_t& max_depth, const char_type* beg, const char_type* end) {
+            const detail::scan_kernels scan = detail::select_scanner();
+            std::size_t                current = 0, current_parent = 0;
+            for (;beg != end;) {
+                switch (*beg) {
+                default: return beg;
+                case ' ': case '\n': case '\t': case '\r': beg = scan.skip_spaces(beg, end); break;
+                case '\"': {
+                    bool             escaped = false;
+                    const char_type* str_end = detail::find_string_close(scan, ++beg, end, escaped);
+                    const string_view str    = make_string(beg, str_end, escaped);
+                    beg = scan.skip_spaces(str_end == end ? end : str_end + 1, end);
+                    if (beg != end && *beg == ':') {
+                        current = emplace(nodes, max_depth, current_parent, str, node_value()); ++beg;
+                    } else { current = emplace_value(nodes, max_depth, current, current_parent, node_value(str)); }
+                } break;
+                case '{': case '[': {
+                    const node_value tag = *beg == '{' ? node_value(document_node_object_tag) : node_value(document_node_array_tag);
+                    current = nodes[current].name.empty() ? emplace(nodes, max_depth, current_parent, string_view(), tag) :
+                    emplace_value(nodes, max_depth, current, current_parent, tag);
+                    current_parent = current; ++beg;
+                } break;
+                case '}': case ']': {
+                    if (current_parent == 0) { return beg; }  // Closes nothing that is open.
+                    current = current_parent;
+                    current_parent = nodes[current_parent].parent; ++beg;
+                } break;
+                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-': {
+                    detail::number_value<int_type, float_type> num;
+                    const char_type* num_end = detail::parse_number(beg, end, num);
+                    if (num_end == nullptr) { return beg; }
+                    emplace_value(nodes, max_depth, current, current_parent, num.literal ? node_value(document_node_number_tag, string_view(beg, num_end))
+                                                                             : num.is_float ? node_value(num.f) : node_value(num.i));
+                    beg = num_end;
+                } break;
+                case 't': {
+                    if (!detail::match_literal(beg, end, "true")) { return beg; }
+                    emplace_value(nodes, max_depth, current, current_parent, node_value(true)); beg += 4;
+                } break;
+                case 'f': {
+                    if (!detail::match_literal(beg, end, "false")) { return beg; }
+                    emplace_value(nodes, max_depth, current, current_parent, node_value(false)); beg += 5;
+                } break;
+                case 'n': {
+                    if (!detail::match_literal(beg, end, "null")) { return beg; }
+                    emplace_value(nodes, max_depth, current, current_parent, node_value()); beg += 4;
+                } break;
+                case ',': ++beg; break;
                 }
             }
             return beg;
         }
+
+        // Same counting sort by depth as document_tree_parser, nodes are trivially copyable here.
+        constexpr void relayout_breadth_first(inserter& nodes, std::size_t max_depth, const inserter_allocator& ia) {
+            std::vector<std::size_t, InserterAllocator<std::size_t>> level(max_depth + 2, 0, InserterAllocator<std::size_t>(ia));
+            for (auto& j : nodes) { ++level[j.depth + 1]; }
+            for (std::size_t i = 1; i != level.size(); ++i) { level[i] += level[i - 1]; }
+            for (auto& j : nodes) { j.index = level[j.depth]++; }
+            tree.nodes_.resize(nodes.size());
+            for (std::size_t i = 1; i != nodes.size(); ++i) {
+                tree.nodes_[nodes[i].index] = node_type(static_cast<std::ptrdiff_t>(nodes[nodes[i].parent].index), nodes[i].name, nodes[i].value);
+            }
+            detail::build_child_index(tree.nodes_, tree.child_index_);
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                              Binary Snapshots                               ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Snapshot file: header, 40 byte node records in BFVT order, then a blob with every string.
+    // Records point at their strings with offsets relative to the record itself, so a mapped file is used as it is.
+    namespace detail {
+        struct snapshot_header {
+            char          magic[8];
+            std::uint32_t version;
+            std::uint32_t byte_order;     // 0x01020304 as written by the saving machine.
+            std::uint32_t node_size;
+            std::uint32_t flags;          // None are defined, readers reject files that set any.
+            std::uint64_t node_count;
+            std::uint64_t nodes_offset;
+            std::uint64_t blob_offset;
+            std::uint64_t blob_size;
+            std::uint64_t reserved;
+        };
+        static_assert(sizeof(snapshot_header) == 64);
+
+        inline constexpr char          snapshot_magic[8]   = {'J', 'X', 'X', 'S', 'N', 'A', 'P', '\0'};
+        inline constexpr std::uint32_t snapshot_version    = 1;
+        inline constexpr std::uint32_t snapshot_byte_order = 0x01020304;
+    }
+
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+    class document_snapshot_node {
+    public:
+        using string_view         = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using int_type            = Integer;
+        using float_type          = FloatingPoint;
+        using value_type          = document_node_value_view<int_type, float_type, CharT>;
+    private:
+        template <class JsonTree>
+        friend void save_snapshot(const JsonTree&, const std::filesystem::path&);
+        template <typename I, typename F, class C>
+        friend class document_tree_snapshot;
+
+        std::int64_t      payload_ = 0;      // Integer, bits of a double, bool, or offset of a string.
+        std::int64_t      name_ = 0;         // Offset of the name from this record.
+        std::uint32_t     name_size_ = 0;
+        std::uint32_t     size_ = 0;         // Size of a string value, or of the text of a number kept as text (payload is then its offset).
+        std::int32_t      pid_ = -1;
+        std::uint32_t     first_child_ = 0;
+        std::uint32_t     child_count_ = 0;
+        std::uint8_t      type_ = 0;
+        std::uint8_t      padding_[3]{};
+
+        const CharT* at_(std::int64_t offset) const { return reinterpret_cast<const CharT*>(reinterpret_cast<const char*>(this) + offset); }
+    public:
+        string_view       name()         const { return string_view(at_(name_), name_size_); }
+        std::ptrdiff_t    parent_index() const { return pid_; }
+
+        // Values are decoded on access, there is nothing to build when a snapshot is opened.
+        value_type        value()        const {
+            switch (static_cast<document_tree_node_type>(type_)) {
+            case document_tree_node_type::boolean:        return value_type(payload_ != 0);
+            case document_tree_node_type::integer:        return value_type(static_cast<int_type>(payload_));
+            case document_tree_node_type::floating_point:
+                if (size_ != 0) { return value_type(document_node_number_tag, string_view(at_(payload_), size_)); }
+                return value_type(static_cast<float_type>(std::bit_cast<double>(payload_)));
+            case document_tree_node_type::string:         return value_type(string_view(at_(payload_), size_));
+            case document_tree_node_type::array:          return value_type(document_node_array_tag);
+            case document_tree_node_type::object:         return value_type(document_node_object_tag);
+            case document_tree_node_type::root:           return value_type(document_node_root_tag);
+            default:                                      return value_type();
+            }
+        }
+    };
+    static_assert(sizeof(document_snapshot_node<>) == 40);
+
+    // Writes tree to path as a snapshot, see document_tree_snapshot. Names and short strings are stored once.
+    template <class JsonTree>
+    void save_snapshot(const JsonTree& tree, const std::filesystem::path& path) {
+        using char_type   = typename JsonTree::string_view::value_type;
+        using string_view = typename JsonTree::string_view;
+        using node        = document_snapshot_node<typename JsonTree::int_type, typename JsonTree::float_type, char_type>;
+        using vt          = document_tree_node_type;
+        // Snapshots have no packed arrays or deferred containers, their children are written as nodes of an unpacked copy.
+        if constexpr (requires(JsonTree& t) { t.unpack_arrays(); t.materialize(); }) {
+            if (std::ranges::any_of(tree.begin(), tree.end(), [](const auto& n) { return n.value().packed() || n.value().deferred(); })) {
+                JsonTree unpacked(tree);
+                unpacked.unpack_arrays();
+                unpacked.materialize();
+                return save_snapshot(unpacked, path);
+            }
+        }
+        if (tree.size() > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) { throw std::length_error("jxxson: too many nodes for a snapshot"); }
+
+        const std::uint64_t nodes_offset = sizeof(detail::snapshot_header);
+        const std::uint64_t blob_offset  = nodes_offset + tree.size() * sizeof(node);
+        std::vector<node>                                  nodes(tree.size());
+        std::basic_string<char_type>                       blob;
+        std::unordered_map<string_view, std::uint64_t>     stored;
+        auto store = [&](string_view str, std::size_t record) -> std::int64_t {
+            std::uint64_t at = blob.size();
+            if (str.size() <= 64) {
+                if (const auto [it, inserted] = stored.try_emplace(str, at); !inserted) { at = it->second; }
+                else { blob.append(str); }
+            } else { blob.append(str); }
+            return static_cast<std::int64_t>(blob_offset + at * sizeof(char_type)) - static_cast<std::int64_t>(nodes_offset + record * sizeof(node));
+        };
+        for (std::size_t i = 0; i != tree.size(); ++i) {
+            const auto  it = tree.begin() + static_cast<std::ptrdiff_t>(i);
+            const auto& v  = it->value();
+            node&       n  = nodes[i];
+            n.pid_  = static_cast<std::int32_t>(it->parent_index());
+            n.type_ = static_cast<std::uint8_t>(v.type);
+            const string_view name = it->name();
+            if (name.size() > std::numeric_limits<std::uint32_t>::max()) { throw std::length_error("jxxson: name too long for a snapshot"); }
+            n.name_ = store(name, i); n.name_size_ = static_cast<std::uint32_t>(name.size());
+            const auto children = it.begin();
+            n.child_count_ = static_cast<std::uint32_t>(it.end() - children);
+            n.first_child_ = n.child_count_ != 0 ? static_cast<std::uint32_t>(children - tree.begin()) : 0;
+            switch (v.type) {
+            case vt::boolean:        n.payload_ = v.template as<bool>() ? 1 : 0; break;
+            case vt::integer:        n.payload_ = static_cast<std::int64_t>(v.template as<typename JsonTree::int_type>()); break;
+            case vt::floating_point:
+                if (!v.literal()) { n.payload_ = std::bit_cast<std::int64_t>(static_cast<double>(v.template as<typename JsonTree::float_type>())); break; }
+                n.payload_ = store(v.literal_text(), i); n.size_ = static_cast<std::uint32_t>(v.literal_text().size());
+                break;
+            case vt::string: {
+                const string_view str = v.template as<string_view>();
+                if (str.size() > std::numeric_limits<std::uint32_t>::max()) { throw std::length_error("jxxson: string too long for a snapshot"); }
+                n.payload_ = store(str, i); n.size_ = static_cast<std::uint32_t>(str.size());
+            } break;
+            default: break;
+            }
+        }
+
+        detail::snapshot_header header{};
+        std::ranges::copy(detail::snapshot_magic, header.magic);
+        header.version      = detail::snapshot_version;
+        header.byte_order   = detail::snapshot_byte_order;
+        header.node_size    = sizeof(node);
+        header.node_count   = tree.size();
+        header.nodes_offset = nodes_offset;
+        header.blob_offset  = blob_offset;
+        header.blob_size    = blob.size() * sizeof(char_type);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(nodes.data()), static_cast<std::streamsize>(nodes.size() * sizeof(node)));
+        out.write(reinterpret_cast<const char*>(blob.data()), static_cast<std::streamsize>(header.blob_size));
+        out.close();
+        if (!out) { throw std::runtime_error("jxxson: " + path.string() + ": could not write snapshot"); }
+    }
+
+    // Read only tree over a mapped snapshot file, opening it checks the header and does no work per node.
+    // Snapshots are only readable on machines with the same byte order. Use verify() on files you do not trust.
+    template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+    class document_tree_snapshot {
+    public:
+        using string_view       = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using node_value        = document_node_value_view<Integer, FloatingPoint, CharT>;
+        using float_type        = FloatingPoint;
+        using int_type          = Integer;
+
+        using value_type        = document_snapshot_node<Integer, FloatingPoint, CharT>;
+        using reference         = const value_type&;
+        using const_reference   = const value_type&;
+        using pointer           = const value_type*;
+        using const_pointer     = const value_type*;
+        using difference_type   = std::ptrdiff_t;
+
+        using container_const_iterator = const value_type*;
+
+        using iterator               = document_tree_node_const_iterator<document_tree_snapshot>;
+        using const_iterator         = document_tree_node_const_iterator<document_tree_snapshot>;
+    private:
+        mapped_file   file_;
+        const_pointer nodes_ = nullptr;
+        std::size_t   size_  = 0;
+    public:
+        explicit document_tree_snapshot(const std::filesystem::path& path) : file_(path) {
+            detail::snapshot_header header{};
+            auto invalid = [&path](const char* why) { return std::runtime_error("jxxson: " + path.string() + ": " + why); };
+            if (file_.size() < sizeof(header)) { throw invalid("not a snapshot"); }
+            std::memcpy(&header, file_.data(), sizeof(header));
+            if (!std::ranges::equal(header.magic, detail::snapshot_magic))   { throw invalid("not a snapshot"); }
+            if (header.version != detail::snapshot_version)                 { throw invalid("unsupported snapshot version"); }
+            if (header.byte_order != detail::snapshot_byte_order)           { throw invalid("snapshot was written with another byte order"); }
+            if (header.flags != 0)                                          { throw invalid("unsupported snapshot flags"); }
+            // Compared without sums or products, which a damaged count or offset could overflow.
+            if (header.node_size != sizeof(value_type) || header.node_count == 0 || header.nodes_offset % alignof(value_type) != 0 ||
+                header.nodes_offset > header.blob_offset || header.blob_offset > file_.size() ||
+                header.node_count > (header.blob_offset - header.nodes_offset) / sizeof(value_type) || header.blob_size > file_.size() - header.blob_offset) {
+                throw invalid("corrupt snapshot header");
+            }
+            nodes_ = reinterpret_cast<const_pointer>(file_.data() + header.nodes_offset);
+            size_  = static_cast<std::size_t>(header.node_count);
+        }
+
+        document_tree_snapshot(document_tree_snapshot&&)            = default;
+        document_tree_snapshot& operator=(document_tree_snapshot&&) = default;
+
+        // Checks every parent, child range and string against the file, O(size()).
+        bool verify() const {
+            detail::snapshot_header header{};
+            std::memcpy(&header, file_.data(), sizeof(header));
+            auto inside = [&](const value_type& n, std::int64_t offset, std::size_t size) {
+                const std::int64_t at = (reinterpret_cast<const char*>(&n) - file_.data()) + offset - static_cast<std::int64_t>(header.blob_offset);
+                return at >= 0 && static_cast<std::uint64_t>(at) <= header.blob_size && size * sizeof(CharT) <= header.blob_size - static_cast<std::uint64_t>(at);
+            };
+            for (std::size_t i = 0; i != size_; ++i) {
+                const value_type& n = nodes_[i];
+                if ((i == 0) != (n.pid_ == -1) || (i != 0 && (n.pid_ < 0 || static_cast<std::size_t>(n.pid_) >= i))) { return false; }
+                if (n.type_ > static_cast<std::uint8_t>(document_tree_node_type::root)) { return false; }
+                if (n.child_count_ != 0 && (n.first_child_ <= i || std::size_t{n.first_child_} + n.child_count_ > size_)) { return false; }
+                if (!inside(n, n.name_, n.name_size_)) { return false; }
+                if (n.type_ == static_cast<std::uint8_t>(document_tree_node_type::string) && !inside(n, n.payload_, n.size_)) { return false; }
+                if (n.type_ == static_cast<std::uint8_t>(document_tree_node_type::floating_point) && n.size_ != 0 && !inside(n, n.payload_, n.size_)) { return false; }
+            }
+            return true;
+        }
+
+        constexpr std::size_t        size() const noexcept { return size_; }
+        constexpr const_pointer      data() const noexcept { return nodes_; }
+        constexpr const_iterator     begin()   const { return const_iterator(this, data());          }
+        constexpr const_iterator     end()     const { return const_iterator(this, data() + size()); }
+        constexpr const_iterator     root()    const { return begin() + 1; }
+
+        // Child ranges are part of the file.
+        constexpr const_iterator search_child_begin(const_iterator parent) const {
+            const auto& n = *parent;
+            return const_iterator(this, n.child_count_ != 0 ? data() + n.first_child_ : data() + size());
+        }
+
+        constexpr const_iterator search_child_end(const_iterator parent) const {
+            const auto& n = *parent;
+            return const_iterator(this, n.child_count_ != 0 ? data() + n.first_child_ + n.child_count_ : data() + size());
+        }
+
+        constexpr const_iterator     access(const_iterator actual_root, string_view name) const {
+            auto it = std::ranges::find_if(actual_root.begin(), actual_root.end(), [name](const auto& v) {
+                return v.name() == name;
+            });
+            return it == actual_root.end() ? end() : it;
+        }
+
+        constexpr const_iterator     access(const_iterator actual_root, std::size_t i) const {
+            if (i + 1 > static_cast<std::size_t>(actual_root.end() - actual_root.begin())) { return end(); }
+            return actual_root.begin() + i;
+        }
+
+        constexpr const_iterator     operator[](string_view name)       const { return access(begin() + 1, name); }
+        constexpr const_iterator     operator[](std::size_t id)         const { return access(begin() + 1, id); }
+        constexpr const_iterator     find(string_view name)             const { return access(begin() + 1, name); }
+        constexpr const_iterator     find(std::size_t id)               const { return access(begin() + 1, id); }
+
+        template <std::output_iterator<CharT> OutputIt>
+        OutputIt format_to(OutputIt out, const format_style& style = format_pretty) const {
+            detail::format_sink<CharT, detail::iterator_flush<CharT, OutputIt>> sink({out});
+            detail::format_tree_to(*this, style, sink);
+            return sink.flush_to.out;
+        }
+
+        template <class Traits>
+        std::basic_ostream<CharT, Traits>& format_to(std::basic_ostream<CharT, Traits>& os, const format_style& style = format_pretty) const {
+            auto flush = [&os](const CharT* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return os;
+        }
+
+        std::basic_string<CharT> to_string(const format_style& style = format_pretty) const {
+            std::basic_string<CharT> str;
+            auto flush = [&str](const CharT* p, std::size_t n) { str.append(p, n); };
+            detail::format_sink<CharT, decltype(flush)> sink(flush);
+            detail::format_tree_to(*this, style, sink);
+            return str;
+        }
+
+        std::basic_string<CharT> to_string(const format_style& style, std::size_t threads) const {
+            std::basic_string<CharT> str;
+            detail::format_tree_parallel_to(*this, style, threads, [&str](const CharT* p, std::size_t n) { str.append(p, n); });
+            return str;
+        }
     };
-}
\ No newline at end of file
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                              Shared Versions                                ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // One document served to many threads while another one changes it. Every published version is an immutable tree,
+    // readers pin the current one with read() without locking and writers build the next one from a copy, so a reader
+    // never sees a change. Versions are reclaimed by epochs: a reader announces the epoch it started in before it loads
+    // the current version, a replaced version is freed once every announced epoch is newer than its replacement.
+    // Writers are serialized, the publisher must outlive its readers. Published trees are materialized first.
+    template <class JsonTree>
+    class document_tree_publisher {
+    public:
+        using tree_type = JsonTree;
+    private:
+        static constexpr std::uint64_t idle = std::numeric_limits<std::uint64_t>::max();
+
+        struct version_type {
+            tree_type     tree;
+            std::uint64_t number;
+        };
+
+        // Reader slots are never freed, a slot is reused by the next read() once its reader is done.
+        struct alignas(64) slot {
+            std::atomic<std::uint64_t> epoch = idle;
+            std::atomic<bool>          used  = false;
+            slot*                      next  = nullptr;
+        };
+
+        std::atomic<const version_type*>                                 current_;
+        std::atomic<std::uint64_t>                                       epoch_ = 0;
+        mutable std::atomic<slot*>                                       slots_ = nullptr;
+        std::mutex                                                       write_;
+        std::vector<std::pair<const version_type*, std::uint64_t>>      retired_;  // Replaced versions and the epoch they were replaced in.
+
+        slot* acquire_slot_() const {
+            slot* head = slots_.load();
+            for (slot* s = head; s != nullptr; s = s->next) {
+                if (!s->used.load(std::memory_order_relaxed) && !s->used.exchange(true)) { return s; }
+            }
+            slot* s = new slot;
+            s->used.store(true, std::memory_order_relaxed);
+            for (s->next = head; !slots_.compare_exchange_weak(s->next, s);) {}
+            return s;
+        }
+
+        // Readers only have const access, which throws on deferred containers, so a lazily parsed tree is materialized.
+        static tree_type&& prepare_(tree_type&& tree) {
+            if constexpr (requires { tree.materialize(); }) { tree.materialize(); }
+            return std::move(tree);
+        }
+
+        std::uint64_t publish_locked_(tree_type&& next) {
+            const version_type* old = current_.load();
+            const std::uint64_t number = old->number + 1;
+            current_.store(new version_type{prepare_(std::move(next)), number});
+            retired_.emplace_back(old, epoch_.fetch_add(1));
+            reclaim_locked_();
+            return number;
+        }
+
+        std::size_t reclaim_locked_() {
+            std::uint64_t oldest = idle;
+            for (slot* s = slots_.load(); s != nullptr; s = s->next) { oldest = std::min(oldest, s->epoch.load()); }
+            std::erase_if(retired_, [oldest](const auto& r) {
+                if (r.second >= oldest) { return false; }
+                delete r.first;
+                return true;
+            });
+            return retired_.size();
+        }
+    public:
+        // Pins one version, it stays valid and unchanged until the reader is destroyed. Hold readers briefly,
+        // every version published meanwhile is kept in memory until the oldest reader is done.
+        class reader {
+        public:
+            reader(reader&& right) noexcept : slot_(std::exchange(right.slot_, nullptr)), version_(right.version_) {}
+            reader& operator=(reader&& right) noexcept {
+                if (this != &right) { release(); slot_ = std::exchange(right.slot_, nullptr); version_ = right.version_; }
+                return *this;
+            }
+            ~reader() { release(); }
+
+            const tree_type& operator*()  const noexcept { return version_->tree; }
+            const tree_type* operator->() const noexcept { return &version_->tree; }
+            std::uint64_t    version()    const noexcept { return version_->number; }
+        private:
+            friend document_tree_publisher;
+            slot*               slot_;
+            const version_type* version_;
+
+            reader(slot* s, const version_type* v) : slot_(s), version_(v) {}
+            void release() noexcept {
+                if (slot_ == nullptr) { return; }
+                slot_->epoch.store(idle);
+                slot_->used.store(false, std::memory_order_release);
+                slot_ = nullptr;
+            }
+        };
+
+        explicit document_tree_publisher(tree_type initial) : current_(new version_type{prepare_(std::move(initial)), 0}) {}
+        document_tree_publisher(const document_tree_publisher&)            = delete;
+        document_tree_publisher& operator=(const document_tree_publisher&) = delete;
+
+        ~document_tree_publisher() {
+            delete current_.load();
+            for (const auto& r : retired_) { delete r.first; }
+            for (slot* s = slots_.load(); s != nullptr;) { delete std::exchange(s, s->next); }
+        }
+
+        // Lock free, a slot is claimed and the current epoch announced before the current version is loaded.
+        reader read() const {
+            slot* s = acquire_slot_();
+            s->epoch.store(epoch_.load());
+            return reader(s, current_.load());
+        }
+
+        // Copies the current version, lets fn change the copy and publishes it. Returns the new version number.
+        template <class Fn>
+        std::uint64_t update(Fn&& fn) {
+            std::lock_guard lock(write_);
+            tree_type next(current_.load()->tree);
+            std::forward<Fn>(fn)(next);
+            return publish_locked_(std::move(next));
+        }
+
+        // Replaces the current version with next.
+        std::uint64_t publish(tree_type next) {
+            std::lock_guard lock(write_);
+            return publish_locked_(std::move(next));
+        }
+
+        std::uint64_t version() const noexcept { return current_.load()->number; }
+
+        // Frees the replaced versions no reader can see anymore, publishing does it too. Returns how many are still kept.
+        std::size_t reclaim() {
+            std::lock_guard lock(write_);
+            return reclaim_locked_();
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                             Streaming Parser                                ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Push parser that reports every token to a handler instead of building a tree. Input is fed in chunks of any size,
+    // a token cut by the end of a chunk is kept until the next chunk completes it, so the parser holds one bit per open
+    // container plus the longest token seen, no matter how long the stream is. Handlers implement any of
+    //   on_start_object(), on_end_object(), on_start_array(), on_end_array(), on_key(string_view), on_value(const node_value&),
+    //   on_end_document()
+    // Strings are decoded, they and the text of numbers kept as text are only valid during the callback.
+    // Top level values may follow each other (NDJSON).
+    template <class Handler, typename Integer = int, typename FloatingPoint = double, class CharT = char, class Allocator = std::allocator<CharT>>
+    class document_sax_parser {
+    public:
+        using string_view        = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using string             = std::basic_string<CharT, std::char_traits<CharT>, Allocator>;
+        using node_value         = document_node_value_view<Integer, FloatingPoint, CharT>;
+        using int_type           = Integer;
+        using float_type         = FloatingPoint;
+        using char_type          = CharT;
+        using allocator_type     = Allocator;
+
+        static_assert(sizeof(char_type) == 1, "document_sax_parser reads narrow character input.");
+
+        Handler& handler;
+
+        constexpr explicit document_sax_parser(Handler& h, const allocator_type& alloc = allocator_type{})
+        : handler(h), stack_(typename std::allocator_traits<Allocator>::template rebind_alloc<bool>(alloc)), partial_(alloc), decoded_(alloc) {}
+
+        // Returns end if the chunk was consumed, or the position of the first byte that is not valid json.
+        // After an error every further chunk is rejected until reset().
+        constexpr const char_type* feed(const char_type* beg, const char_type* end) {
+            if (failed_) { return beg; }
+            const char_type* stop = (token_ == token::none) ? parse_(beg, end) : resume_(beg, end);
+            consumed_ += static_cast<std::size_t>(stop - beg);
+            return stop;
+        }
+
+        template <std::ranges::contiguous_range Range>
+        requires (std::is_same_v<std::ranges::range_value_t<Range>, char_type>)
+        constexpr auto feed(const Range& chunk) {
+            return feed(std::ranges::data(chunk), std::ranges::data(chunk) + std::ranges::size(chunk));
+        }
+
+        // Ends the input, a number at the very end has no delimiter and is only reported here.
+        // True if the stream was valid and did not stop inside a value.
+        constexpr bool finish() {
+            if (!failed_ && token_ == token::number) {
+                token_ = token::none;
+                complete_number_(partial_.data(), partial_.data() + partial_.size());
+            }
+            return !failed_ && token_ == token::none && stack_.empty() && expect_ == expect::value;
+        }
+
+        // Reads the whole stream in blocks, pipes are consumed as they deliver data.
+        template <class Traits>
+        bool parse(std::basic_istream<char_type, Traits>& in, std::size_t block_size = 64 * 1024) {
+            std::vector<char_type> block(block_size);
+            while (in) {
+                in.read(block.data(), static_cast<std::streamsize>(block.size()));
+                const auto n = static_cast<std::size_t>(in.gcount());
+                if (n == 0) { break; }
+                if (feed(block.data(), block.data() + n) != block.data() + n) { return false; }
+            }
+            return finish();
+        }
+
+        constexpr void reset() {
+            stack_.clear(); partial_.clear();
+            expect_ = expect::value; token_ = token::none;
+            failed_ = false; consumed_ = 0;
+        }
+
+        constexpr bool        failed() const { return failed_; }
+        constexpr std::size_t depth()  const { return stack_.size(); }
+        constexpr std::size_t offset() const { return consumed_; }  // Bytes accepted so far, the error position after a failure.
+    private:
+        enum class expect : std::uint8_t { value, value_or_end, key, key_or_end, colon, comma_or_end };
+        enum class token  : std::uint8_t { none, string, number, literal };
+
+        std::vector<bool, typename std::allocator_traits<Allocator>::template rebind_alloc<bool>> stack_;  // True for objects.
+        string            partial_;
+        string            decoded_;
+        string_view       literal_;
+        std::size_t       consumed_ = 0;
+        expect            expect_   = expect::value;
+        token             token_    = token::none;
+        bool              is_key_   = false;
+        bool              escaped_  = false;
+        bool              failed_   = false;
+
+        constexpr bool in_object() const { return !stack_.empty() && stack_.back(); }
+
+        constexpr void after_value_() {
+            if (!stack_.empty()) { expect_ = expect::comma_or_end; return; }
+            expect_ = expect::value;
+            if constexpr (requires { handler.on_end_document(); }) { handler.on_end_document(); }
+        }
+
+        constexpr bool value_(const node_value& v) {
+            if (expect_ != expect::value && expect_ != expect::value_or_end) { return false; }
+            if constexpr (requires { handler.on_value(v); }) { handler.on_value(v); }
+            after_value_();
+            return true;
+        }
+
+        constexpr bool complete_string_(const char_type* beg, const char_type* end, bool escaped) {
+            string_view str(beg, static_cast<std::size_t>(end - beg));
+            if (escaped) {
+                decoded_.clear();
+                detail::unescape_to(decoded_, beg, end);
+                str = decoded_;
+            }
+            if (!is_key_) { return value_(node_value(str)); }
+            if constexpr (requires { handler.on_key(str); }) { handler.on_key(str); }
+            expect_ = expect::colon;
+            return true;
+        }
+
+        constexpr bool complete_number_(const char_type* beg, const char_type* end) {
+            detail::number_value<int_type, float_type> num;
+            if (detail::parse_number(beg, end, num) != end) { failed_ = true; return false; }
+            if (!value_(num.literal ? node_value(document_node_number_tag, string_view(beg, end)) : num.is_float ? node_value(num.f) : node_value(num.i))) { failed_ = true; }
+            return !failed_;
+        }
+
+        constexpr bool complete_literal_() {
+            switch (literal_[0]) {
+            case 't': return value_(node_value(true));
+            case 'f': return value_(node_value(false));
+            default:  return value_(node_value());
+            }
+        }
+
+        // A backslash run of odd length at the end of a cut string escapes the first byte of the next chunk.
+        constexpr bool cut_inside_escape_() const {
+            const auto last = partial_.find_last_not_of(char_type{'\\'});
+            const auto run  = partial_.size() - (last == string::npos ? 0 : last + 1);
+            return run % 2 == 1;
+        }
+
+        // Continues the token cut by the previous chunk, then goes on with the rest of the chunk.
+        constexpr const char_type* resume_(const char_type* beg, const char_type* end) {
+            const detail::scan_kernels scan = detail::select_scanner();
+            const char_type*           it   = beg;
+            switch (token_) {
+            case token::string: {
+                if (beg != end && cut_inside_escape_()) { ++it; }
+                const char_type* str_end = detail::find_string_close(scan, it, end, escaped_);
+                partial_.append(beg, str_end);
+                if (str_end == end) { return end; }
+                token_ = token::none;
+                if (!complete_string_(partial_.data(), partial_.data() + partial_.size(), escaped_)) { failed_ = true; return str_end; }
+                it = str_end + 1;
+            } break;
+            case token::number: {
+                it = detail::find_number_end(beg, end);
+                partial_.append(beg, it);
+                if (it == end) { return end; }
+                token_ = token::none;
+                if (!complete_number_(partial_.data(), partial_.data() + partial_.size())) { return it; }
+            } break;
+            case token::literal: {
+                const std::size_t n = std::min(literal_.size() - partial_.size(), static_cast<std::size_t>(end - beg));
+                if (literal_.substr(partial_.size(), n) != string_view(beg, n)) { failed_ = true; return beg; }
+                partial_.append(beg, beg + n);
+                if (partial_.size() != literal_.size()) { return end; }
+                token_ = token::none;
+                if (!complete_literal_()) { failed_ = true; return beg; }
+                it = beg + n;
+            } break;
+            case token::none: break;
+            }
+            return parse_(it, end);
+        }
+
+        constexpr const char_type* parse_(const char_type* beg, const char_type* end) {
+            const detail::scan_kernels scan = detail::select_scanner();
+            for (;beg != end;) {
+                switch (*beg) {
+                default: failed_ = true; return beg;
+                case ' ': case '\n': case '\t': case '\r': beg = scan.skip_spaces(beg, end); break;
+                case '\"': {
+                    if (expect_ == expect::colon || expect_ == expect::comma_or_end) { failed_ = true; return beg; }
+                    is_key_ = expect_ == expect::key || expect_ == expect::key_or_end;
+                    bool             escaped = false;
+                    const char_type* str_end = detail::find_string_close(scan, beg + 1, end, escaped);
+                    if (str_end == end) {
+                        partial_.assign(beg + 1, end);
+                        token_ = token::string; escaped_ = escaped;
+                        return end;
+                    }
+                    if (!complete_string_(beg + 1, str_end, escaped)) { failed_ = true; return beg; }
+                    beg = str_end + 1;
+                } break;
+                case '{': case '[': {
+                    if (expect_ != expect::value && expect_ != expect::value_or_end) { failed_ = true; return beg; }
+                    const bool is_object = *beg == '{';
+                    stack_.push_back(is_object);
+                    if (is_object) {
+                        if constexpr (requires { handler.on_start_object(); }) { handler.on_start_object(); }
+                        expect_ = expect::key_or_end;
+                    } else {
+                        if constexpr (requires { handler.on_start_array(); }) { handler.on_start_array(); }
+                        expect_ = expect::value_or_end;
+                    }
+                    ++beg;
+                } break;
+                case '}': {
+                    if (!in_object() || (expect_ != expect::key_or_end && expect_ != expect::comma_or_end)) { failed_ = true; return beg; }
+                    stack_.pop_back();
+                    if constexpr (requires { handler.on_end_object(); }) { handler.on_end_object(); }
+                    after_value_(); ++beg;
+                } break;
+                case ']': {
+                    if (stack_.empty() || in_object() || (expect_ != expect::value_or_end && expect_ != expect::comma_or_end)) { failed_ = true; return beg; }
+                    stack_.pop_back();
+                    if constexpr (requires { handler.on_end_array(); }) { handler.on_end_array(); }
+                    after_value_(); ++beg;
+                } break;
+                case ',': {
+                    if (expect_ != expect::comma_or_end) { failed_ = true; return beg; }
+                    expect_ = in_object() ? expect::key : expect::value; ++beg;
+                } break;
+                case ':': {
+                    if (expect_ != expect::colon) { failed_ = true; return beg; }
+                    expect_ = expect::value; ++beg;
+                } break;
+                case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': case '-': {
+                    const char_type* num_end = detail::find_number_end(beg, end);
+                    if (num_end == end) {
+                        if (expect_ != expect::value && expect_ != expect::value_or_end) { failed_ = true; return beg; }
+                        partial_.assign(beg, end);
+                        token_ = token::number;
+                        return end;
+                    }
+                    if (!complete_number_(beg, num_end)) { return beg; }
+                    beg = num_end;
+                } break;
+                case 't': case 'f': case 'n': {
+                    literal_ = *beg == 't' ? string_view("true") : *beg == 'f' ? string_view("false") : string_view("null");
+                    const std::size_t n = std::min(literal_.size(), static_cast<std::size_t>(end - beg));
+                    if (literal_.substr(0, n) != string_view(beg, n)) { failed_ = true; return beg; }
+                    if (n != literal_.size()) {
+                        if (expect_ != expect::value && expect_ != expect::value_or_end) { failed_ = true; return beg; }
+                        partial_.assign(beg, end);
+                        token_ = token::literal;
+                        return end;
+                    }
+                    if (!complete_literal_()) { failed_ = true; return beg; }
+                    beg += n;
+                } break;
+                }
+            }
+            return beg;
+        }
+    };
+
+    // Handler for document_sax_parser that builds a document tree from the events it is given. Forward only the events
+    // of the values you want to keep, every completed top level value replaces the content of tree and sets done().
+    template <class JsonTree, template <class Ty> class InserterAllocator = std::allocator>
+    class document_tree_builder {
+    public:
+        using parser             = document_tree_parser<InserterAllocator, JsonTree>;
+        using inserter           = typename parser::inserter;
+        using inserter_allocator = typename parser::inserter_allocator;
+        using string             = typename JsonTree::string;
+        using string_view        = typename JsonTree::string_view;
+        using node_value         = typename JsonTree::node_value;
+        using char_type          = typename string::value_type;
+        using string_allocator   = typename string::allocator_type;
+
+        JsonTree& tree;
+
+        constexpr explicit document_tree_builder(JsonTree& t, const string_allocator& sa = string_allocator{}, const inserter_allocator& ia = inserter_allocator{})
+        : tree(t), inserter_(sa, ia), current_(inserter_.root()), current_parent_(inserter_.root()), sa_(sa), ia_(ia) {}
+
+        constexpr bool        done()  const { return done_; }
+        constexpr std::size_t depth() const { return depth_; }
+
+        constexpr void on_start_object() { open_(node_value(document_node_object_tag, sa_)); }
+        constexpr void on_start_array()  { open_(node_value(document_node_array_tag, sa_)); }
+        constexpr void on_end_object()   { close_(); }
+        constexpr void on_end_array()    { close_(); }
+
+        constexpr void on_key(string_view name) {
+            done_ = false;
+            current_ = inserter_.emplace(current_parent_, name, node_value(sa_), sa_);
+        }
+
+        template <class Value>
+        constexpr void on_value(const Value& v) {
+            using vt = document_tree_node_type;
+            switch (v.type) {
+            case vt::boolean:        place_(node_value(v.template as<bool>(), sa_)); break;
+            case vt::integer:        place_(node_value(static_cast<typename JsonTree::int_type>(v.template as<typename Value::int_type>()), sa_)); break;
+            case vt::floating_point:
+                if (v.literal()) { place_(node_value(document_node_number_tag, v.literal_text(), sa_)); }
+                else { place_(node_value(static_cast<typename JsonTree::float_type>(v.template as<typename Value::float_type>()), sa_)); }
+                break;
+            case vt::string:         place_(node_value(v.template as<string_view>(), sa_)); break;
+            default:                 place_(node_value(sa_)); break;
+            }
+            if (depth_ == 0) { build_(); }
+        }
+    private:
+        inserter                              inserter_;
+        typename inserter::container_iterator current_, current_parent_;
+        string_allocator                      sa_;
+        inserter_allocator                    ia_;
+        std::size_t                           depth_ = 0;
+        bool                                  done_  = false;
+
+        constexpr void place_(node_value&& v) {
+            done_ = false;
+            if (current_parent_->value.type == document_tree_node_type::object) { current_->value = std::move(v); }
+            else { current_ = inserter_.emplace(current_parent_, string_view(), std::move(v), sa_); }
+        }
+
+        constexpr void open_(node_value&& v) {
+            place_(std::move(v));
+            current_parent_ = current_; ++depth_;
+        }
+
+        constexpr void close_() {
+            current_ = current_parent_;
+            current_parent_ = current_parent_->parent;
+            if (--depth_ == 0) { build_(); }
+        }
+
+        constexpr void build_() {
+            parser{tree}.relayout_breadth_first(inserter_, ia_);
+            inserter_ = inserter(sa_, ia_);
+            current_ = current_parent_ = inserter_.root();
+            done_ = true;
+        }
+    };
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                               Path Queries                                  ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // RFC 6901 JSON Pointer compiled into steps, "" is the whole document. A token that is exactly * matches
+    // every child (pass wildcards = false for strict pointers). Tokens that are array indices also match object keys.
+    template <class CharT = char>
+    class document_path {
+    public:
+        using string_view = std::basic_string_view<CharT, std::char_traits<CharT>>;
+        using string      = std::basic_string<CharT, std::char_traits<CharT>>;
+
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        struct step {
+            string      name;
+            std::size_t index    = npos;   // Set if name is an array index.
+            bool        wildcard = false;
+
+            constexpr bool operator==(const step&) const = default;
+        };
+
+        constexpr explicit document_path(string_view path, bool wildcards = true) {
+            if (path.empty()) { return; }
+            if (path.front() != CharT{'/'}) { throw std::invalid_argument("jxxson::document_path must be empty or start with '/'"); }
+            for (std::size_t pos = 1;;) {
+                const std::size_t slash = std::min(path.find(CharT{'/'}, pos), path.size());
+                steps_.push_back(compile_(path.substr(pos, slash - pos), wildcards));
+                if (slash == path.size()) { break; }
+                pos = slash + 1;
+            }
+        }
+
+        constexpr const std::vector<step>& steps() const noexcept { return steps_; }
+        constexpr std::size_t              size()  const noexcept { return steps_.size(); }
+    private:
+        std::vector<step> steps_;
+
+        static constexpr step compile_(string_view token, bool wildcards) {
+            step s;
+            if (wildcards && token.size() == 1 && token.front() == CharT{'*'}) { s.wildcard = true; return s; }
+            for (std::size_t i = 0; i != token.size(); ++i) {
+                if (token[i] != CharT{'~'}) { s.name.push_back(token[i]); continue; }
+                if (++i == token.size() || (token[i] != CharT{'0'} && token[i] != CharT{'1'})) {
+                    throw std::invalid_argument("jxxson::document_path has a '~' not followed by '0' or '1'");
+                }
+                s.name.push_back(token[i] == CharT{'0'} ? CharT{'~'} : CharT{'/'});
+            }
+            // Array indices have no leading zeros, "-" (past the end) never matches anything here.
+            const bool digits = !s.name.empty() && std::ranges::all_of(s.name, [](CharT c) { return c >= CharT{'0'} && c <= CharT{'9'}; });
+            if (digits && (s.name.size() == 1 || s.name.front() != CharT{'0'})) {
+                s.index = 0;
+                for (CharT c : s.name) {
+                    if (s.index > (npos - 9) / 10) { s.index = npos; break; }
+                    s.index = s.index * 10 + static_cast<std::size_t>(c - CharT{'0'});
+                }
+            }
+            return s;
+        }
+    };
+
+    // A batch of paths evaluated together against a tree (or view), read only. Paths are merged into a trie,
+    // so a shared prefix is walked once, and the walk goes level by level with frontier nodes in index order,
+    // which in BFVT means it only ever moves forward through the node vector. Results are nodes, so run() throws
+    // std::logic_error if a path goes on below a packed array (read its elements with element()) or a deferred container.
+    template <class JsonTree>
+    class document_query {
+    public:
+        using tree_type      = JsonTree;
+        using char_type      = typename JsonTree::string_view::value_type;
+        using path_type      = document_path<char_type>;
+        using step           = typename path_type::step;
+        using const_iterator = typename JsonTree::const_iterator;
+
+        constexpr document_query() { trie_.emplace_back(); }
+
+        // Returns the id of the path, results of it are read by results(id).
+        constexpr std::size_t add(const path_type& path) {
+            std::size_t at = 0;
+            for (const auto& st : path.steps()) {
+                auto edge = std::ranges::find_if(trie_[at].edges, [&](std::size_t e) { return trie_[e].st == st; });
+                if (edge != trie_[at].edges.end()) { at = *edge; continue; }
+                trie_.push_back({st, {}, {}});
+                trie_[at].edges.push_back(trie_.size() - 1);
+                at = trie_.size() - 1;
+            }
+            trie_[at].ends.push_back(results_.size());
+            results_.emplace_back();
+            return results_.size() - 1;
+        }
+
+        constexpr std::size_t add(typename path_type::string_view path) { return add(path_type(path)); }
+
+        constexpr void run(const tree_type& tree) {
+            for (auto& r : results_) { r.clear(); }
+            if (tree.size() < 2) { return; }
+            std::vector<std::pair<const_iterator, std::size_t>> frontier{{tree.begin() + 1, 0}}, next;
+            while (!frontier.empty()) {
+                next.clear();
+                for (const auto& [node, at] : frontier) {
+                    for (std::size_t id : trie_[at].ends) { results_[id].push_back(node); }
+                    if (trie_[at].edges.empty() || !node->value().parent_type()) { continue; }
+                    if constexpr (requires { node->value().packed(); }) {
+                        if (node->value().packed()) { throw std::logic_error("jxxson: a path reaches into a packed array, unpack it first"); }
+                    }
+                    if constexpr (requires { node->value().deferred(); }) {
+                        if (node->value().deferred()) { throw std::logic_error("jxxson: a path reaches into a deferred container, materialize it first"); }
+                    }
+                    const bool is_array = node->value().type == document_tree_node_type::array;
+                    for (std::size_t e : trie_[at].edges) {
+                        const step& st = trie_[e].st;
+                        if (st.wildcard) {
+                            for (auto c = node.begin(), end = node.end(); c != end; ++c) { next.emplace_back(c, e); }
+                            continue;
+                        }
+                        if (is_array && st.index == path_type::npos) { continue; }
+                        const auto c = is_array ? tree.access(node, st.index) : tree.access(node, typename tree_type::string_view(st.name));
+                        if (c != tree.end()) { next.emplace_back(c, e); }
+                    }
+                }
+                frontier.swap(next);
+            }
+        }
+
+        constexpr const std::vector<const_iterator>& results(std::size_t id) const { return results_[id]; }
+        constexpr std::size_t                        size()                  const noexcept { return results_.size(); }
+    private:
+        struct trie_node {
+            step                     st;
+            std::vector<std::size_t> edges;
+            std::vector<std::size_t> ends;
+        };
+        std::vector<trie_node>                   trie_;
+        std::vector<std::vector<const_iterator>> results_;
+    };
+
+    // Every node matched by path, in document order.
+    template <class JsonTree>
+    constexpr auto select(const JsonTree& tree, const document_path<typename JsonTree::string_view::value_type>& path) {
+        document_query<JsonTree> query;
+        query.add(path);
+        query.run(tree);
+        return query.results(0);
+    }
+
+    // First node matched by path, or end().
+    template <class JsonTree>
+    constexpr auto select_first(const JsonTree& tree, const document_path<typename JsonTree::string_view::value_type>& path) {
+        const auto matches = select(tree, path);
+        return matches.empty() ? tree.end() : matches.front();
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                            Parallel Algorithms                              ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Nodes of one depth are contiguous in BFVT, and so are the descendants of a node on every depth below it, so a subtree
+    // is one index range per level, found with two binary searches over parent indices. The algorithms split these ranges
+    // into runs of about equal size and work on up to threads threads, subtrees of fewer than 16384 nodes per thread run on
+    // the calling thread. They read the tree through const access only, which changes nothing in any tree type, so they are
+    // race free against other readers (not against writers, see document_tree_publisher).
+    namespace detail {
+        inline constexpr std::size_t parallel_min_run = 16384;
+
+        struct level_range {
+            std::size_t depth;
+            std::size_t first;
+            std::size_t last;
+        };
+
+        // Levels below node, children of node are depth 1.
+        template <class Tree>
+        std::vector<level_range> descendant_levels(const Tree& tree, std::size_t node) {
+            const auto* nodes = tree.data();
+            auto first_child = [&](std::size_t from, std::size_t parent) {
+                return static_cast<std::size_t>(std::partition_point(nodes + from, nodes + tree.size(), [parent](const auto& n) {
+                    return n.parent_index() < static_cast<std::ptrdiff_t>(parent);
+                }) - nodes);
+            };
+            std::vector<level_range> levels;
+            for (std::size_t lo = node, hi = node + 1, depth = 1;; ++depth) {
+                const std::size_t first = first_child(hi, lo), last = first_child(first, hi);
+                if (first == last) { return levels; }
+                levels.push_back(level_range{depth, first, last});
+                lo = first; hi = last;
+            }
+        }
+
+        // Calls fn(task, depth, first, last) for runs of levels, runs of one task are handled in index order by one thread
+        // and tasks are in index order too. Returns the number of tasks.
+        template <class Fn>
+        std::size_t for_each_run(const std::vector<level_range>& levels, std::size_t threads, Fn&& fn) {
+            std::size_t total = 0;
+            for (const auto& l : levels) { total += l.last - l.first; }
+            const std::size_t tasks = std::clamp<std::size_t>(total / parallel_min_run, 1, std::max<std::size_t>(threads, 1));
+            const std::size_t grain = (total + tasks - 1) / tasks;
+            std::vector<std::vector<level_range>> runs(tasks);
+            std::size_t task = 0, budget = grain;
+            for (const auto& l : levels) {
+                for (std::size_t first = l.first; first != l.last;) {
+                    const std::size_t n = std::min(budget, l.last - first);
+                    runs[task].push_back(level_range{l.depth, first, first + n});
+                    first += n;
+                    if ((budget -= n) == 0) { task = std::min(task + 1, tasks - 1); budget = grain; }
+                }
+            }
+            parallel_for(tasks, [&](std::size_t k) {
+                for (const auto& r : runs[k]) { fn(k, r.depth, r.first, r.last); }
+            });
+            return tasks;
+        }
+
+        template <class It>
+        concept node_iterator = requires(const It& it) { it->parent_index(); it->value(); };
+
+        // Calls fn with a temporary node for every element of a packed array at index, the child node it would be in a
+        // tree that does not pack, until fn returns true. True if it did.
+        template <class Node, class Fn>
+        bool any_packed_element(const Node& array, std::size_t index, Fn&& fn) {
+            if constexpr (requires { array.value().packed(); }) {
+                using value_type = std::remove_cvref_t<decltype(array.value())>;
+                const value_type& v = array.value();
+                auto visit = [&](auto elements) {
+                    return std::ranges::any_of(elements, [&](auto e) {
+                        const Node element(static_cast<std::ptrdiff_t>(index), typename Node::string_view(), value_type(e, v.get_allocator()));
+                        return static_cast<bool>(fn(element));
+                    });
+                };
+                if (v.packed_type() == document_tree_node_type::integer)        { return visit(v.template as<std::span<const typename value_type::int_type>>()); }
+                if (v.packed_type() == document_tree_node_type::floating_point) { return visit(v.template as<std::span<const typename value_type::float_type>>()); }
+            }
+            return false;
+        }
+
+        // The members of a deferred container are not nodes, an algorithm would pass over them, so it throws instead.
+        template <class Node>
+        void require_materialized(const Node& node) {
+            if constexpr (requires { node.value().deferred(); }) {
+                if (node.value().deferred()) { throw std::logic_error("jxxson: container is not materialized, call materialize() first"); }
+            }
+        }
+
+        // Trees stored as one breadth first vector of nodes: document_tree, document_tree_view and document_tree_snapshot.
+        template <class Tree>
+        concept breadth_first_tree = requires(const Tree& t) { t.data()->parent_index(); t.size(); t.begin(); };
+    }
+
+    // Calls fn(depth, first, last) for runs of descendants of node, every run is a range of const iterators within one
+    // level (children of node are depth 1). Runs are handed to several threads at once, fn must be safe to call concurrently.
+    // Elements of packed arrays are not nodes and are in no run, they are read from the span of their array.
+    // Deferred containers below node throw (before fn sees their run), materialize them first.
+    template <detail::breadth_first_tree Tree, detail::node_iterator Node, class Fn>
+    void for_each_level(const Tree& tree, Node node, Fn&& fn, std::size_t threads = 1) {
+        detail::for_each_run(detail::descendant_levels(tree, static_cast<std::size_t>(&*node - tree.data())), threads,
+            [&](std::size_t, std::size_t depth, std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i != last; ++i) { detail::require_materialized(tree.data()[i]); }
+                fn(depth, tree.begin() + first, tree.begin() + last);
+            });
+    }
+
+    template <detail::breadth_first_tree Tree, class Fn> requires (!detail::node_iterator<Fn>)
+    void for_each_level(const Tree& tree, Fn&& fn, std::size_t threads = 1) { for_each_level(tree, tree.begin(), std::forward<Fn>(fn), threads); }
+
+    // Number of descendants of node for which pred(node) is true. Elements of packed arrays are given to pred as
+    // temporary nodes without a name, the children they would be if the array was not packed. Deferred containers throw.
+    template <detail::breadth_first_tree Tree, detail::node_iterator Node, class Pred>
+    std::size_t count_if(const Tree& tree, Node node, Pred&& pred, std::size_t threads = 1) {
+        std::vector<std::size_t> counts(std::max<std::size_t>(threads, 1), 0);
+        const auto*              nodes = tree.data();
+        const std::size_t        tasks = detail::for_each_run(detail::descendant_levels(tree, static_cast<std::size_t>(&*node - nodes)), threads,
+            [&](std::size_t k, std::size_t, std::size_t first, std::size_t last) {
+                std::size_t n = 0;
+                for (std::size_t i = first; i != last; ++i) {
+                    detail::require_materialized(nodes[i]);
+                    n += static_cast<bool>(pred(std::as_const(nodes[i])));
+                    detail::any_packed_element(nodes[i], i, [&](const auto& e) { n += static_cast<bool>(pred(e)); return false; });
+                }
+                counts[k] += n;
+            });
+        return std::reduce(counts.begin(), counts.begin() + static_cast<std::ptrdiff_t>(tasks));
+    }
+
+    template <detail::breadth_first_tree Tree, class Pred> requires (!detail::node_iterator<Pred>)
+    std::size_t count_if(const Tree& tree, Pred&& pred, std::size_t threads = 1) { return count_if(tree, tree.begin(), std::forward<Pred>(pred), threads); }
+
+    // First descendant of node in breadth first order for which pred(node) is true, or end().
+    // Runs behind a match that was already found are skipped. Elements of packed arrays are tested as count_if tests them,
+    // a matching element finds its array. A deferred container in front of the match throws.
+    template <detail::breadth_first_tree Tree, detail::node_iterator Node, class Pred>
+    auto find_if(const Tree& tree, Node node, Pred&& pred, std::size_t threads = 1) {
+        constexpr std::size_t    none  = std::numeric_limits<std::size_t>::max();
+        std::atomic<std::size_t> found = none;
+        const auto*              nodes = tree.data();
+        detail::for_each_run(detail::descendant_levels(tree, static_cast<std::size_t>(&*node - nodes)), threads,
+            [&](std::size_t, std::size_t, std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i != last && i < found.load(std::memory_order_relaxed); ++i) {
+                    detail::require_materialized(nodes[i]);
+                    if (!pred(std::as_const(nodes[i])) && !detail::any_packed_element(nodes[i], i, pred)) { continue; }
+                    for (std::size_t at = found.load(); i < at && !found.compare_exchange_weak(at, i);) {}
+                    return;
+                }
+            });
+        return found != none ? tree.begin() + static_cast<std::ptrdiff_t>(found.load()) : tree.end();
+    }
+
+    template <detail::breadth_first_tree Tree, class Pred> requires (!detail::node_iterator<Pred>)
+    auto find_if(const Tree& tree, Pred&& pred, std::size_t threads = 1) { return find_if(tree, tree.begin(), std::forward<Pred>(pred), threads); }
+
+    // Calls fn(node) for every descendant of node, fn may change node.value() but not its name. Trees whose string
+    // allocator is stateful (an arena is not thread safe) are transformed on the calling thread. Packed arrays below node
+    // are unpacked first so fn can change the type of their elements, iterators to nodes deeper than node are invalidated.
+    // A deferred container below node throws before fn is called on any node.
+    template <detail::breadth_first_tree Tree, detail::node_iterator Node, class Fn>
+    void transform_values(Tree& tree, Node node, Fn&& fn, std::size_t threads = 1) {
+        using string_allocator = typename Tree::string::allocator_type;
+        if constexpr (!std::allocator_traits<string_allocator>::is_always_equal::value) { threads = 1; }
+        const std::size_t at = static_cast<std::size_t>(&*node - tree.data());
+        if constexpr (requires { tree.unpack_arrays(tree.begin()); }) { tree.unpack_arrays(tree.begin() + static_cast<std::ptrdiff_t>(at)); }
+        auto*      nodes  = tree.data();
+        const auto levels = detail::descendant_levels(std::as_const(tree), at);
+        if constexpr (requires { tree.deferred(); }) {
+            if (tree.deferred()) { for (const auto& l : levels) { for (std::size_t i = l.first; i != l.last; ++i) { detail::require_materialized(nodes[i]); } } }
+        }
+        detail::for_each_run(levels, threads,
+            [&](std::size_t, std::size_t, std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i != last; ++i) { fn(nodes[i]); }
+            });
+    }
+
+    template <detail::breadth_first_tree Tree, class Fn> requires (!detail::node_iterator<Fn>)
+    void transform_values(Tree& tree, Fn&& fn, std::size_t threads = 1) { transform_values(tree, tree.begin(), std::forward<Fn>(fn), threads); }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                               Struct Mapping                                ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Describes a type for deserialize and serialize, specialize it with a constexpr tuple of members:
+    //     template <> struct jxxson::document_schema<accessor> {
+    //         static constexpr auto members = std::tuple{jxxson::document_member{"count", &accessor::count}, ...};
+    //     };
+    template <class Ty>
+    struct document_schema;
+
+    // Key of an object and the data member its value is read into.
+    template <class Class, class Ty>
+    struct document_member {
+        std::string_view name;
+        Ty Class::*      pointer;
+    };
+
+    template <class Class, class Ty>
+    document_member(std::string_view, Ty Class::*) -> document_member<Class, Ty>;
+
+    namespace detail {
+        template <class Ty>
+        concept has_schema = requires { std::tuple_size<std::remove_cvref_t<decltype(document_schema<Ty>::members)>>::value; };
+
+        template <class Ty>                    struct is_std_vector                          : std::false_type {};
+        template <class Ty, class A>           struct is_std_vector<std::vector<Ty, A>>      : std::true_type  {};
+        template <class Ty>                    struct is_std_array                           : std::false_type {};
+        template <class Ty, std::size_t N>     struct is_std_array<std::array<Ty, N>>        : std::true_type  {};
+        template <class Ty>                    struct is_std_optional                        : std::false_type {};
+        template <class Ty>                    struct is_std_optional<std::optional<Ty>>     : std::true_type  {};
+        template <class Ty>                    struct is_std_string                          : std::false_type {};
+        template <class T, class A>            struct is_std_string<std::basic_string<char, T, A>> : std::true_type {};
+
+        template <class Ty>
+        inline constexpr std::size_t schema_size = std::tuple_size_v<std::remove_cvref_t<decltype(document_schema<Ty>::members)>>;
+
+        constexpr std::uint32_t schema_hash(std::string_view key, std::uint32_t seed) {
+            std::uint32_t h = 2166136261u ^ seed;
+            for (const char c : key) { h = (h ^ static_cast<unsigned char>(c)) * 16777619u; }
+            return h;
+        }
+
+        // Perfect hash of the member names, slots hold member index + 1. Names no seed separates are searched one by one.
+        template <std::size_t N>
+        struct schema_keys {
+            std::array<std::string_view, N>                                                 names{};
+            std::array<std::uint16_t, std::bit_ceil(std::max<std::size_t>(N * 2, 2)) * 4>   slots{};
+            std::uint32_t                                                                   seed    = 0;
+            std::uint32_t                                                                   mask    = 0;
+            bool                                                                            perfect = false;
+
+            // Index of the member named key, N if there is none.
+            constexpr std::size_t find(std::string_view key) const {
+                if (perfect) {
+                    const std::size_t slot = slots[schema_hash(key, seed) & mask];
+                    return slot != 0 && names[slot - 1] == key ? slot - 1 : N;
+                }
+                return static_cast<std::size_t>(std::ranges::find(names, key) - names.begin());
+            }
+        };
+
+        template <class Ty>
+        constexpr auto make_schema_keys() {
+            constexpr std::size_t N = schema_size<Ty>;
+            static_assert(N < std::numeric_limits<std::uint16_t>::max(), "jxxson: too many members in a schema");
+            schema_keys<N> keys;
+            [&]<std::size_t... I>(std::index_sequence<I...>) { ((keys.names[I] = std::get<I>(document_schema<Ty>::members).name), ...); }(std::make_index_sequence<N>());
+            for (std::size_t size = std::bit_ceil(std::max<std::size_t>(N * 2, 2)); size <= keys.slots.size(); size *= 2) {
+                for (std::uint32_t seed = 0; seed != 256; ++seed) {
+                    std::ranges::fill(keys.slots, std::uint16_t{0});
+                    bool separated = true;
+                    for (std::size_t i = 0; i != N && separated; ++i) {
+                        auto& slot = keys.slots[schema_hash(keys.names[i], seed) & (size - 1)];
+                        separated  = slot == 0;
+                        slot       = static_cast<std::uint16_t>(i + 1);
+                    }
+                    if (separated) { keys.seed = seed; keys.mask = static_cast<std::uint32_t>(size - 1); keys.perfect = true; return keys; }
+                }
+            }
+            return keys;
+        }
+
+        template <class Ty>
+        inline constexpr auto schema_keys_of = make_schema_keys<Ty>();
+
+        // Reads json on contiguous narrow input straight into described types, with the tokenizer of the tree parsers.
+        // Every read starts at the first character of a value and returns its end, or nullptr after keeping the
+        // position of the first error in error.
+        struct schema_reader {
+            scan_kernels scan;
+            const char*  end;
+            const char*  error = nullptr;
+            std::string  key;  // Keys with escapes are decoded here.
+
+            constexpr schema_reader(const scan_kernels& s, const char* e) : scan(s), end(e) {}
+
+            constexpr const char* fail(const char* at) {
+                if (error == nullptr) { error = at; }
+                return nullptr;
+            }
+
+            constexpr const char* skip_spaces(const char* beg) const { return beg != end && is_space(*beg) ? scan.skip_spaces(beg, end) : beg; }
+
+            template <class Ty>
+            constexpr const char* read(const char* beg, Ty& out) {
+                if (beg == end) { return fail(beg); }
+                if constexpr (std::is_same_v<Ty, bool>) {
+                    if (match_literal(beg, end, "true"))  { out = true;  return beg + 4; }
+                    if (match_literal(beg, end, "false")) { out = false; return beg + 5; }
+                    return fail(beg);
+                } else if constexpr (std::is_integral_v<Ty>) {
+                    number_value<std::conditional_t<std::is_signed_v<Ty>, long long, unsigned long long>, double> num;
+                    const char* num_end = parse_number(beg, end, num);
+                    if (num_end == nullptr || num.is_float || !std::in_range<Ty>(num.i)) { return fail(beg); }
+                    out = static_cast<Ty>(num.i);
+                    return num_end;
+                } else if constexpr (std::is_floating_point_v<Ty>) {
+                    number_value<long long, Ty> num;
+                    const char* num_end = parse_number(beg, end, num);
+                    if (num_end == nullptr || (num.literal && !std::isfinite(num.f))) { return fail(beg); }
+                    out = num.is_float ? num.f : static_cast<Ty>(num.i);
+                    return num_end;
+                } else if constexpr (is_std_string<Ty>::value) {
+                    bool        escaped = false;
+                    const char* close   = *beg == '\"' ? find_string_close(scan, beg + 1, end, escaped) : end;
+                    if (close == end) { return fail(beg); }
+                    out.clear();
+                    if (escaped) { unescape_to(out, beg + 1, close); } else { out.append(beg + 1, close); }
+                    return close + 1;
+                } else if constexpr (is_std_optional<Ty>::value) {
+                    if (match_literal(beg, end, "null")) { out.reset(); return beg + 4; }
+                    return read(beg, out.emplace());
+                } else if constexpr (is_std_vector<Ty>::value) {
+                    out.clear();
+                    return read_array(beg, [&](const char* it) { return read(it, out.emplace_back()); });
+                } else if constexpr (is_std_array<Ty>::value) {
+                    std::size_t count = 0;
+                    const char* array_end = read_array(beg, [&](const char* it) { return count != out.size() ? read(it, out[count++]) : fail(it); });
+                    return array_end != nullptr && count != out.size() ? fail(beg) : array_end;
+                } else if constexpr (has_schema<Ty>) {
+                    return read_object(beg, out);
+                } else {
+                    static_assert(sizeof(Ty) == 0, "jxxson: type has no document_schema and is not a string, number, bool, vector, array or optional");
+                }
+            }
+
+            template <class Element>
+            constexpr const char* read_array(const char* beg, Element&& element) {
+                if (*beg != '[') { return fail(beg); }
+                if ((beg = skip_spaces(beg + 1)) != end && *beg == ']') { return beg + 1; }
+                for (;;) {
+                    if ((beg = element(beg)) == nullptr) { return nullptr; }
+                    if ((beg = skip_spaces(beg)) == end) { return fail(beg); }
+                    if (*beg == ']') { return beg + 1; }
+                    if (*beg != ',') { return fail(beg); }
+                    beg = skip_spaces(beg + 1);
+                }
+            }
+
+            template <class Ty, std::size_t I>
+            static constexpr const char* read_member(schema_reader& reader, const char* beg, Ty& out) {
+                return reader.read(beg, out.*(std::get<I>(document_schema<Ty>::members).pointer));
+            }
+
+            // Keys are looked up in the perfect hash and dispatched through a table of member readers.
+            template <class Ty>
+            constexpr const char* read_object(const char* beg, Ty& out) {
+                using member_reader = const char* (*)(schema_reader&, const char*, Ty&);
+                constexpr std::size_t N    = schema_size<Ty>;
+                const auto&           keys = schema_keys_of<Ty>;
+                constexpr auto readers = []<std::size_t... I>(std::index_sequence<I...>) {
+                    return std::array<member_reader, N>{&read_member<Ty, I>...};
+                }(std::make_index_sequence<N>());
+
+                if (*beg != '{') { return fail(beg); }
+                if ((beg = skip_spaces(beg + 1)) != end && *beg == '}') { return beg + 1; }
+                for (;;) {
+                    bool        escaped = false;
+                    const char* close   = beg != end && *beg == '\"' ? find_string_close(scan, beg + 1, end, escaped) : end;
+                    if (close == end) { return fail(beg); }
+                    std::string_view name(beg + 1, static_cast<std::size_t>(close - beg - 1));
+                    if (escaped) { key.clear(); unescape_to(key, beg + 1, close); name = key; }
+                    const std::size_t index = keys.find(name);
+                    if ((beg = skip_spaces(close + 1)) == end || *beg != ':') { return fail(beg); }
+                    beg = skip_spaces(beg + 1);
+                    if ((beg = index != N ? readers[index](*this, beg, out) : skip_value(beg)) == nullptr) { return nullptr; }
+                    if ((beg = skip_spaces(beg)) == end) { return fail(beg); }
+                    if (*beg == '}') { return beg + 1; }
+                    if (*beg != ',') { return fail(beg); }
+                    beg = skip_spaces(beg + 1);
+                }
+            }
+
+            // Values of keys that are not described, containers are only checked for balanced brackets.
+            constexpr const char* skip_value(const char* beg) {
+                if (beg == end) { return fail(beg); }
+                switch (*beg) {
+                case '\"': {
+                    bool escaped = false;
+                    const char* close = find_string_close(scan, beg + 1, end, escaped);
+                    return close != end ? close + 1 : fail(beg);
+                }
+                case '{': case '[': {
+                    const char* close = find_container_end(scan, beg, end);
+                    return close != nullptr ? close : fail(beg);
+                }
+                case 't': return match_literal(beg, end, "true")  ? beg + 4 : fail(beg);
+                case 'f': return match_literal(beg, end, "false") ? beg + 5 : fail(beg);
+                case 'n': return match_literal(beg, end, "null")  ? beg + 4 : fail(beg);
+                default: {
+                    number_value<long long, double> num;
+                    const char* num_end = parse_number(beg, end, num);
+                    return num_end != nullptr ? num_end : fail(beg);
+                }
+                }
+            }
+        };
+
+        // Writes value laid out as the tree printers would lay out the same document, the caller writes what comes before
+        // the value (indent and key) and after it (comma and newline). Members holding an empty optional are left out.
+        template <class Ty, class Sink>
+        constexpr void write_schema_value(const format_style& style, std::size_t depth, const Ty& value, Sink& sink) {
+            auto open = [&](char bracket) {
+                sink.put(bracket);
+                if (style.pretty) { sink.put('\n'); }
+            };
+            auto close = [&](char bracket) {
+                if (style.pretty) { sink.fill(depth * style.indent, ' '); }
+                sink.put(bracket);
+            };
+            auto next = [&](bool is_last) {
+                if (!is_last) { sink.put(','); }
+                if (style.pretty) { sink.put('\n'); }
+            };
+            if constexpr (std::is_same_v<Ty, bool>) {
+                sink.write(value ? std::string_view("true") : std::string_view("false"));
+            } else if constexpr (std::is_arithmetic_v<Ty>) {
+                write_number(value, sink);
+            } else if constexpr (is_std_string<Ty>::value) {
+                sink.put('\"');
+                escape_to(std::string_view(value), sink);
+                sink.put('\"');
+            } else if constexpr (is_std_optional<Ty>::value) {
+                if (value) { write_schema_value(style, depth, *value, sink); } else { sink.write(std::string_view("null")); }
+            } else if constexpr (is_std_vector<Ty>::value || is_std_array<Ty>::value) {
+                open('[');
+                for (std::size_t i = 0; i != value.size(); ++i) {
+                    if (style.pretty) { sink.fill((depth + 1) * style.indent, ' '); }
+                    write_schema_value(style, depth + 1, value[i], sink);
+                    next(i + 1 == value.size());
+                }
+                close(']');
+            } else if constexpr (has_schema<Ty>) {
+                constexpr auto& members = document_schema<Ty>::members;
+                open('{');
+                [&]<std::size_t... I>(std::index_sequence<I...>) {
+                    auto present = [&](const auto& member) {
+                        if constexpr (is_std_optional<std::remove_cvref_t<decltype(value.*member.pointer)>>::value) { return (value.*member.pointer).has_value(); }
+                        else { return true; }
+                    };
+                    const std::array<bool, sizeof...(I)> written{present(std::get<I>(members))...};
+                    std::size_t last = 0;
+                    for (std::size_t i = 0; i != sizeof...(I); ++i) { if (written[i]) { last = i; } }
+                    auto member = [&](std::size_t i, const auto& m) {
+                        if (!written[i]) { return; }
+                        if (style.pretty) { sink.fill((depth + 1) * style.indent, ' '); }
+                        sink.put('\"');
+                        escape_to(m.name, sink);
+                        sink.put('\"');
+                        sink.put(':');
+                        write_schema_value(style, depth + 1, value.*m.pointer, sink);
+                        next(i == last);
+                    };
+                    (member(I, std::get<I>(members)), ...);
+                }(std::make_index_sequence<schema_size<Ty>>());
+                close('}');
+            } else {
+                static_assert(sizeof(Ty) == 0, "jxxson: type has no document_schema and is not a string, number, bool, vector, array or optional");
+            }
+        }
+
+        template <class Ty, class Sink>
+        constexpr void write_schema_document(const Ty& value, const format_style& style, Sink& sink) {
+            write_schema_value(style, 0, value, sink);
+            if (style.pretty) { sink.put('\n'); }
+            sink.flush();
+        }
+    }
+
+    // Reads input straight into value, without building a tree. Ty is a type with a document_schema, or a string, number,
+    // bool, std::vector, std::array (of exactly its size) or std::optional of those. Keys may come in any order, keys that are
+    // not described are skipped and members without a key keep their value. Returns where reading stopped, the end of input
+    // if it was one value (with spaces around it) and every part of it had the type of its member.
+    template <class Ty, std::ranges::contiguous_range Range>
+    requires (std::is_same_v<std::ranges::range_value_t<Range>, char>)
+    constexpr auto deserialize(const Range& input, Ty& value) {
+        const char*           first = std::ranges::data(input);
+        detail::schema_reader reader{detail::select_scanner(), first + std::ranges::size(input)};
+        const char*           stop  = reader.read(reader.skip_spaces(first), value);
+        stop = stop != nullptr ? reader.skip_spaces(stop) : reader.error;
+        return std::ranges::begin(input) + (stop - first);
+    }
+
+    // Writes value as json, with the same layout the tree printers give the same document.
+    template <class Ty, std::output_iterator<char> OutputIt>
+    constexpr OutputIt serialize_to(OutputIt out, const Ty& value, const format_style& style = format_pretty) {
+        detail::format_sink<char, detail::iterator_flush<char, OutputIt>> sink({out});
+        detail::write_schema_document(value, style, sink);
+        return sink.flush_to.out;
+    }
+
+    template <class Ty, class Traits>
+    std::basic_ostream<char, Traits>& serialize_to(std::basic_ostream<char, Traits>& os, const Ty& value, const format_style& style = format_pretty) {
+        auto flush = [&os](const char* p, std::size_t n) { os.write(p, static_cast<std::streamsize>(n)); };
+        detail::format_sink<char, decltype(flush)> sink(flush);
+        detail::write_schema_document(value, style, sink);
+        return os;
+    }
+
+    template <class Ty>
+    std::string serialize(const Ty& value, const format_style& style = format_pretty) {
+        std::string str;
+        auto flush = [&str](const char* p, std::size_t n) { str.append(p, n); };
+        detail::format_sink<char, decltype(flush)> sink(flush);
+        detail::write_schema_document(value, style, sink);
+        return str;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                             Arena Allocation                                ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    namespace pmr {
+        // Bump allocator for documents that are parsed, used and thrown away, deallocation does nothing
+        // and reset() gives back everything at once. If a document spilled out of the first block,
+        // reset() grows that block to the high-water mark so the next document of the same size fits in it.
+        // Trees and views allocated from the arena must be destroyed before reset().
+        class document_arena : public std::pmr::memory_resource {
+            // Forwards to upstream and counts how many bytes did not fit into the first block.
+            class spill_resource : public std::pmr::memory_resource {
+            public:
+                std::pmr::memory_resource* upstream;
+                std::size_t                spilled = 0;
+
+                explicit spill_resource(std::pmr::memory_resource* u) : upstream(u) {}
+            private:
+                void* do_allocate(std::size_t bytes, std::size_t alignment) override { spilled += bytes; return upstream->allocate(bytes, alignment); }
+                void  do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override { upstream->deallocate(p, bytes, alignment); }
+                bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+            };
+
+            spill_resource                                       spill_;
+            std::size_t                                          capacity_;
+            void*                                                block_;
+            std::optional<std::pmr::monotonic_buffer_resource>   monotonic_;
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override { return monotonic_->allocate(bytes, alignment); }
+            void  do_deallocate(void*, std::size_t, std::size_t) override {}
+            bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+        public:
+            explicit document_arena(std::size_t capacity = 65536, std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+            : spill_(upstream), capacity_(capacity), block_(upstream->allocate(capacity, alignof(std::max_align_t))) {
+                monotonic_.emplace(block_, capacity_, &spill_);
+            }
+
+            document_arena(const document_arena&)            = delete;
+            document_arena& operator=(const document_arena&) = delete;
+
+            ~document_arena() override {
+                monotonic_.reset();
+                spill_.upstream->deallocate(block_, capacity_, alignof(std::max_align_t));
+            }
+
+            std::size_t capacity() const noexcept { return capacity_; }
+
+            void reset() {
+                monotonic_.reset();
+                if (spill_.spilled != 0) {
+                    spill_.upstream->deallocate(block_, capacity_, alignof(std::max_align_t));
+                    capacity_ += spill_.spilled;
+                    block_     = spill_.upstream->allocate(capacity_, alignof(std::max_align_t));
+                    spill_.spilled = 0;
+                }
+                monotonic_.emplace(block_, capacity_, &spill_);
+            }
+        };
+
+        template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+        using document_tree = jxxson::document_tree<Integer, FloatingPoint, CharT, std::pmr::polymorphic_allocator<CharT>,
+                                                     std::pmr::polymorphic_allocator<document_tree_node<Integer, FloatingPoint, CharT, std::pmr::polymorphic_allocator<CharT>>>>;
+
+        template <class JsonTree = document_tree<>>
+        using document_tree_parser = jxxson::document_tree_parser<std::pmr::polymorphic_allocator, JsonTree>;
+
+        template <typename Integer = int, typename FloatingPoint = double, class CharT = char>
+        using document_tree_view = jxxson::document_tree_view<Integer, FloatingPoint, CharT,
+                                                              std::pmr::polymorphic_allocator<document_tree_view_node<Integer, FloatingPoint, CharT>>>;
+
+        template <class JsonTreeView = document_tree_view<>>
+        using document_tree_view_parser = jxxson::document_tree_view_parser<std::pmr::polymorphic_allocator, JsonTreeView>;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////////////
+    ///                          Newline Delimited Input                            ///
+    ///////////////////////////////////////////////////////////////////////////////////
+
+    // Reads one json document per line (NDJSON) into the same tree, blank lines are skipped. The tree keeps its capacity
+    // between records and the parser's temporary nodes come from an arena that is reset per record, so once the biggest
+    // record has been seen parsing allocates nothing but the tree's long strings.
+    template <class JsonTree = document_tree<>>
+    class document_ndjson_reader {
+    public:
+        using parser           = pmr::document_tree_parser<JsonTree>;
+        using string           = typename JsonTree::string;
+        using string_view      = typename JsonTree::string_view;
+        using char_type        = typename string::value_type;
+        using string_allocator = typename string::allocator_type;
+
+        static_assert(sizeof(char_type) == 1, "document_ndjson_reader reads narrow character input.");
+
+        constexpr document_ndjson_reader(const char_type* beg, const char_type* end, std::size_t first_line = 1,
+                                         std::size_t init_cap = 1024, const string_allocator& sa = string_allocator{})
+        : tree_(init_cap, sa), arena_(), sa_(sa), pos_(beg), end_(end), next_line_(first_line) {}
+
+        template <std::ranges::contiguous_range Range>
+        requires (std::is_same_v<std::ranges::range_value_t<Range>, char_type>)
+        constexpr explicit document_ndjson_reader(const Range& input, std::size_t first_line = 1)
+        : document_ndjson_reader(std::ranges::data(input), std::ranges::data(input) + std::ranges::size(input), first_line) {}
+
+        // Parses the next record into tree(), false once the input is exhausted.
+        bool next() {
+            const detail::scan_kernels scan = detail::select_scanner();
+            while (pos_ != end_) {
+                const char_type* beg = pos_;
+                const char_type* eol = std::find(beg, end_, char_type{'\n'});
+                pos_  = eol == end_ ? end_ : eol + 1;
+                line_ = next_line_++;
+                if (scan.skip_spaces(beg, eol) == eol) { continue; }
+                arena_.reset();
+                const char_type* stop = parser{tree_}(beg, eol, sa_, &arena_);
+                record_ = string_view(beg, static_cast<std::size_t>(eol - beg));
+                valid_  = scan.skip_spaces(stop, eol) == eol;
+                return true;
+            }
+            return false;
+        }
+
+        constexpr JsonTree&       tree()         { return tree_; }
+        constexpr const JsonTree& tree()   const { return tree_; }
+        constexpr string_view     record() const { return record_; }
+        constexpr std::size_t     line()   const { return line_; }   // Line of the current record, counted from first_line.
+        constexpr bool            valid()  const { return valid_; }  // False if the parser stopped before the end of the record.
+    private:
+        JsonTree             tree_;
+        pmr::document_arena  arena_;
+        string_allocator     sa_;
+        const char_type*     pos_;
+        const char_type*     end_;
+        string_view          record_;
+        std::size_t          next_line_;
+        std::size_t          line_  = 0;
+        bool                 valid_ = false;
+    };
+
+    // Splits input at line boundaries into one slice per thread, every thread reads its slice with its own reader
+    // and calls fn(reader) for each record. fn is called concurrently, records of a slice arrive in input order.
+    template <class JsonTree = document_tree<>, std::ranges::contiguous_range Range, class Fn>
+    void parse_ndjson(const Range& input, Fn&& fn, std::size_t threads = 1) {
+        using char_type = std::ranges::range_value_t<Range>;
+        const char_type*  beg = std::ranges::data(input);
+        const char_type*  end = beg + std::ranges::size(input);
+        const std::size_t n   = std::max<std::size_t>(1, std::min<std::size_t>(threads, std::ranges::size(input) / 4096 + 1));
+
+        std::vector<const char_type*> cuts(n + 1, end);
+        cuts[0] = beg;
+        for (std::size_t i = 1; i != n; ++i) {
+            const char_type* eol = std::find(std::max(cuts[i - 1], beg + (end - beg) * static_cast<std::ptrdiff_t>(i) / static_cast<std::ptrdiff_t>(n)), end, char_type{'\n'});
+            cuts[i] = eol == end ? end : eol + 1;
+        }
+        auto run = [&](std::size_t i, std::size_t first_line) {
+            document_ndjson_reader<JsonTree> reader(cuts[i], cuts[i + 1], first_line);
+            while (reader.next()) { fn(reader); }
+        };
+
+        // Slices only know their first line number once the newlines before them are counted.
+        std::vector<std::size_t> first_line(n, 1);
+        for (std::size_t i = 1; i != n; ++i) { first_line[i] = first_line[i - 1] + static_cast<std::size_t>(std::count(cuts[i - 1], cuts[i], char_type{'\n'})); }
+
+        detail::parallel_for(n, [&](std::size_t i) { run(i, first_line[i]); });
+    }
+}
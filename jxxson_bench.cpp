@@ -0,0 +1,694 @@
+//
+// MIT License
+// 
+// Copyright (c) 2025 Henry Du
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <filesystem>
+
+#include "jxxson.hpp"
+
+using parser   = jxxson::document_tree_parser<>;
+using inserter = parser::inserter;
+
+// Every allocation made through global new is counted, so each benchmark can report its allocations.
+static std::size_t allocations = 0;
+
+// Every form of new ends in counted_alloc and every form of delete in counted_free, so no pair is mismatched.
+[[gnu::noinline]] static void* counted_alloc(std::size_t n, std::size_t align = alignof(std::max_align_t)) {
+    ++allocations;
+    n = n != 0 ? n : 1;
+    void* p = align <= alignof(std::max_align_t) ? std::malloc(n) : std::aligned_alloc(align, (n + align - 1) / align * align);
+    if (p == nullptr) { throw std::bad_alloc(); }
+    return p;
+}
+[[gnu::noinline]] static void counted_free(void* p) noexcept { std::free(p); }
+
+void* operator new  (std::size_t n)                                        { return counted_alloc(n); }
+void* operator new[](std::size_t n)                                        { return counted_alloc(n); }
+void* operator new  (std::size_t n, std::align_val_t a)                    { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a)                    { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void  operator delete  (void* p) noexcept                                  { counted_free(p); }
+void  operator delete[](void* p) noexcept                                  { counted_free(p); }
+void  operator delete  (void* p, std::size_t) noexcept                     { counted_free(p); }
+void  operator delete[](void* p, std::size_t) noexcept                     { counted_free(p); }
+void  operator delete  (void* p, std::align_val_t) noexcept                { counted_free(p); }
+void  operator delete[](void* p, std::align_val_t) noexcept                { counted_free(p); }
+void  operator delete  (void* p, std::size_t, std::align_val_t) noexcept   { counted_free(p); }
+void  operator delete[](void* p, std::size_t, std::align_val_t) noexcept   { counted_free(p); }
+
+struct measure {
+    double      ms     = 1e300;  // Best of all runs.
+    std::size_t allocs = 0;      // Allocations of one run.
+};
+
+template <class Fn>
+static measure best_of(std::size_t times, Fn&& fn) {
+    measure m;
+    for (std::size_t i = 0; i != times; ++i) {
+        const std::size_t allocs = allocations;
+        auto beg = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        m.ms     = std::min(m.ms, std::chrono::duration<double, std::milli>(end - beg).count());
+        m.allocs = allocations - allocs;
+    }
+    return m;
+}
+
+static void report_bytes(const std::string& name, const measure& m, std::size_t bytes) {
+    std::cout << "  " << name << ": " << m.ms << " ms, " << static_cast<double>(bytes) / (1024.0 * 1024.0) / (m.ms / 1000.0) << " MB/s, " << m.allocs << " allocs\n";
+}
+
+static void report_ops(const std::string& name, const measure& m, std::size_t ops) {
+    std::cout << "  " << name << ": " << m.ms * 1e6 / static_cast<double>(ops) << " ns/op, " << static_cast<double>(m.allocs) / static_cast<double>(ops) << " allocs/op\n";
+}
+
+// The BFVT conversion jxxson used before: one filtered scan of the whole inserter per depth level.
+static void legacy_relayout(inserter& in, std::vector<jxxson::document_tree<>::value_type>& out) {
+    out.resize(in.size());
+    std::size_t counter = 1;
+    for (std::size_t i = 1; i != in.depth() + 1; ++i) {
+        for (auto& j : in | std::views::filter([i](auto& node) { return node.depth == i; })) {
+            j.index = counter;
+            out[counter++] = jxxson::document_tree<>::value_type(j.parent->index, j.name, j.value);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+///                               Corpora                                       ///
+///////////////////////////////////////////////////////////////////////////////////
+
+// Arrays of nested objects, depth levels each.
+static std::string deep_corpus(std::size_t count, std::size_t depth) {
+    std::string doc = "[";
+    for (std::size_t i = 0; i != count; ++i) {
+        if (i != 0) { doc += ','; }
+        for (std::size_t d = 0; d != depth; ++d) { doc += "{\"level\":" + std::to_string(d) + ",\"next\":"; }
+        doc += "null";
+        doc.append(depth, '}');
+    }
+    return doc += "]";
+}
+
+// Objects with many keys each.
+static std::string wide_corpus(std::size_t objects, std::size_t keys) {
+    std::string doc = "[";
+    for (std::size_t i = 0; i != objects; ++i) {
+        doc += i != 0 ? ",{" : "{";
+        for (std::size_t k = 0; k != keys; ++k) { doc += (k != 0 ? ",\"field_" : "\"field_") + std::to_string(k) + "\":" + std::to_string(k * i); }
+        doc += "}";
+    }
+    return doc += "]";
+}
+
+static std::string number_corpus(std::size_t count) {
+    std::mt19937                          rng(42);
+    std::uniform_real_distribution<float> real(-1000.0f, 1000.0f);
+    std::string doc = "[";
+    for (std::size_t i = 0; i != count; ++i) {
+        if (i != 0) { doc += ','; }
+        char buf[64];
+        doc.append(buf, i % 2 == 0 ? std::to_chars(buf, buf + sizeof(buf), real(rng)).ptr : std::to_chars(buf, buf + sizeof(buf), static_cast<int>(rng() % 1000000)).ptr);
+    }
+    return doc += "]";
+}
+
+// glTF like nodes and accessors, most of the values are in short arrays of floats or integers.
+static std::string geometry_corpus(std::size_t count) {
+    std::mt19937                           rng(3);
+    std::uniform_real_distribution<double> real(-100.0, 100.0);
+    std::string doc = "[";
+    auto floats = [&](std::size_t n) {
+        doc += '[';
+        for (std::size_t i = 0; i != n; ++i) {
+            char buf[64];
+            if (i != 0) { doc += ','; }
+            doc.append(buf, std::to_chars(buf, buf + sizeof(buf), real(rng), std::chars_format::fixed, 4).ptr);
+        }
+        doc += ']';
+    };
+    for (std::size_t i = 0; i != count; ++i) {
+        doc += i != 0 ? ",{\"translation\":" : "{\"translation\":";
+        floats(3);  doc += ",\"rotation\":";
+        floats(4);  doc += ",\"matrix\":";
+        floats(16); doc += ",\"children\":[";
+        for (std::size_t c = 0, n = rng() % 8; c != n; ++c) { doc += (c != 0 ? "," : "") + std::to_string(rng() % 100000); }
+        doc += "],\"mesh\":" + std::to_string(i) + "}";
+    }
+    return doc += "]";
+}
+
+static std::string string_corpus(std::size_t count, bool escapes) {
+    std::mt19937 rng(7);
+    std::string  doc = "[";
+    for (std::size_t i = 0; i != count; ++i) {
+        doc += i != 0 ? ",\"" : "\"";
+        const std::size_t length = 8 + rng() % 56;
+        for (std::size_t c = 0; c != length; ++c) {
+            if (escapes && rng() % 8 == 0) {
+                static constexpr const char* sequences[] = {"\\\"", "\\\\", "\\n", "\\t", "\\u00e9", "\\/"};
+                doc += sequences[rng() % 6];
+            } else { doc += static_cast<char>('a' + rng() % 26); }
+        }
+        doc += '\"';
+    }
+    return doc += "]";
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+///                              Benchmarks                                     ///
+///////////////////////////////////////////////////////////////////////////////////
+
+static void bench_parse_and_format(const std::string& text, std::size_t times) {
+    const std::size_t bytes = text.size();
+    report_bytes("parse (streambuf)", best_of(times, [&] {
+        std::istringstream      is(text);
+        jxxson::document_tree<> tree;
+        parser{tree}(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+    }), bytes);
+    report_bytes("parse (contiguous)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree}(text);
+    }), bytes);
+    report_bytes("parse (contiguous, validate utf-8)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree, true}(text);
+    }), bytes);
+    report_bytes("parse (contiguous, pack arrays)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree, false, true}(text);
+    }), bytes);
+    report_bytes("parse (contiguous, lazy)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree, false, false, true}(text);
+    }), bytes);
+    std::size_t valid = 0;
+    report_bytes("find_invalid_utf8 only", best_of(times, [&] { valid += jxxson::find_invalid_utf8(text); }), bytes);
+    {
+        jxxson::pmr::document_arena arena;
+        report_bytes("parse (contiguous, arena, reset per document)", best_of(times, [&] {
+            {
+                jxxson::pmr::document_tree<> tree(1024, &arena, &arena);
+                jxxson::pmr::document_tree_parser<>{tree}(text, &arena, &arena);
+            }
+            arena.reset();
+        }), bytes);
+    }
+    report_bytes("parse (contiguous, zero copy view)", best_of(times, [&] {
+        jxxson::document_tree_view<> view;
+        jxxson::document_tree_view_parser<>{view}(text);
+    }), bytes);
+    {
+        struct counter {
+            std::size_t values = 0;
+            void on_value(const jxxson::document_node_value_view<>&) { ++values; }
+        } events;
+        jxxson::document_sax_parser<counter> sax(events);
+        report_bytes("sax, 4 KiB chunks, count values", best_of(times, [&] {
+            sax.reset();
+            for (std::size_t i = 0; i < bytes; i += 4096) { sax.feed(text.data() + i, text.data() + std::min(bytes, i + 4096)); }
+            sax.finish();
+        }), bytes);
+    }
+
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+    std::string out;
+    report_bytes("format_to (back_inserter)", best_of(times, [&] { out.clear(); tree.format_to(std::back_inserter(out)); }), bytes);
+    report_bytes("format_to (ostreambuf_iterator)", best_of(times, [&] { std::ostringstream os; tree.format_to(std::ostreambuf_iterator<char>(os)); }), bytes);
+    report_bytes("format_to (ostream)", best_of(times, [&] { std::ostringstream os; tree.format_to(os); }), bytes);
+    report_bytes("to_string (pretty)", best_of(times, [&] { out = tree.to_string(); }), bytes);
+    report_bytes("to_string (minified)", best_of(times, [&] { out = tree.to_string(jxxson::format_minified); }), bytes);
+    {
+        jxxson::document_tree<> packed;
+        parser{packed, false, true}(text);
+        report_bytes("to_string (minified, packed arrays)", best_of(times, [&] { out = packed.to_string(jxxson::format_minified); }), bytes);
+        std::cout << "  " << packed.size() << " nodes with packed arrays\n";
+    }
+    tree.child_index(false);
+    report_bytes("to_string (pretty, no child index)", best_of(times, [&] { out = tree.to_string(); }), bytes);
+
+    // Stage timings need fresh inserters every round, so only the stage itself is timed.
+    // Each relayout reads the inserter tokenized right before it, so both start from an equally warm cache.
+    measure tokenize, tokenize_generic, relayout, legacy;
+    for (std::size_t i = 0; i != times; ++i) {
+        jxxson::document_tree<>                          fresh;
+        std::vector<jxxson::document_tree<>::value_type> nodes;
+        inserter in1, in2, in3;
+        const auto t1 = best_of(1, [&] { parser::parse_depth_first(in1, text.data(), text.data() + text.size()); });
+        const auto t3 = best_of(1, [&] { parser{fresh}.relayout_breadth_first(in1); });
+        const auto t2 = best_of(1, [&] { parser::parse_depth_first(in2, text.begin(), text.end()); });
+        parser::parse_depth_first(in3, text.data(), text.data() + text.size());
+        const auto t4 = best_of(1, [&] { legacy_relayout(in3, nodes); });
+        if (t1.ms < tokenize.ms)         { tokenize = t1; }
+        if (t2.ms < tokenize_generic.ms) { tokenize_generic = t2; }
+        if (t3.ms < relayout.ms)         { relayout = t3; }
+        if (t4.ms < legacy.ms)           { legacy = t4; }
+    }
+    report_bytes("stage 1: depth first tokenize (contiguous)", tokenize, bytes);
+    report_bytes("stage 1: depth first tokenize (generic iterator)", tokenize_generic, bytes);
+    report_bytes("stage 2: breadth first relayout (counting sort)", relayout, bytes);
+    report_bytes("stage 2: breadth first relayout (per depth filter, legacy)", legacy, bytes);
+    std::cout << "  " << tree.size() << " nodes, " << sizeof(jxxson::document_tree<>::value_type) << " bytes per node\n";
+}
+
+static void bench_lookup(std::size_t times) {
+    // Lookup by name in one flat object, every key is hit once per round.
+    for (std::size_t keys : {8, 32, 128, 512, 2048}) {
+        std::vector<std::string> names;
+        for (std::size_t i = 0; i != keys; ++i) { names.push_back("field_" + std::to_string((i * 7919) % keys)); }
+
+        jxxson::document_tree<> tree;
+        parser{tree}(wide_corpus(1, keys));
+        auto object = tree.root().begin();
+        auto lookup = [&] {
+            std::size_t hits = 0;
+            for (const auto& name : names) { hits += tree.access(object, name) != tree.end(); }
+            if (hits != keys) { std::cout << "lookup mismatch\n"; }
+        };
+        report_ops("access by name, " + std::to_string(keys) + " keys, linear", best_of(times, lookup), keys);
+        tree.key_index_threshold(16);
+        report_ops("access by name, " + std::to_string(keys) + " keys, hashed", best_of(times, lookup), keys);
+    }
+}
+
+static void bench_tree_api(const std::string& text, std::size_t times) {
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+
+    constexpr std::size_t chain = 10000;
+    report_ops("find (top level name)", best_of(times, [&] {
+        for (std::size_t i = 0; i != chain; ++i) { if (tree.find("materials") == tree.end()) { std::cout << "find failed\n"; } }
+    }), chain);
+    report_ops("operator[] (chain of 3)", best_of(times, [&] {
+        for (std::size_t i = 0; i != chain; ++i) { if (tree["scenes"][0]["nodes"] == tree.end()) { std::cout << "operator[] failed\n"; } }
+    }), chain);
+
+    // Only the edits are timed, every round starts from a fresh copy of the tree.
+    auto edit = [&](std::size_t rounds, auto&& fn) {
+        measure best;
+        for (std::size_t i = 0; i != rounds; ++i) {
+            jxxson::document_tree<> copy = tree;
+            auto m = best_of(1, [&] { fn(copy); });
+            if (m.ms < best.ms) { best = m; }
+        }
+        return best;
+    };
+
+    // Emplacing below an early object shifts every later node.
+    constexpr std::size_t emplaces = 200;
+    report_ops("emplace into the middle", edit(times, [&](auto& copy) {
+        const auto asset = copy.find("asset") - copy.begin();  // Emplace may reallocate, keep an index.
+        for (std::size_t i = 0; i != emplaces; ++i) { copy.emplace(copy.begin() + asset, "extra", jxxson::document_tree<>::node_value(static_cast<int>(i))); }
+    }), emplaces);
+    report_ops("edit batch into the middle (2000 inserts, one apply)", edit(times, [&](auto& copy) {
+        jxxson::document_tree_edit<jxxson::document_tree<>> batch(copy);
+        const auto asset = copy.find("asset");
+        for (std::size_t i = 0; i != emplaces * 10; ++i) { batch.emplace(asset, "extra", jxxson::document_tree<>::node_value(static_cast<int>(i))); }
+        copy.apply(batch);
+    }), emplaces * 10);
+    // Children of the parent of the last node can be appended without shifting.
+    report_ops("emplace at the tail", edit(times, [&](auto& copy) {
+        const auto last_parent = (copy.end() - 1)->parent_index();
+        for (std::size_t i = 0; i != emplaces * 100; ++i) { copy.emplace(copy.begin() + last_parent, "extra", jxxson::document_tree<>::node_value(static_cast<int>(i))); }
+    }), emplaces * 100);
+
+    report_bytes("remove + erase (\"accessors\" subtree)", edit(times, [&](auto& copy) {
+        copy.remove(copy.find("accessors")); copy.erase(copy.begin());
+    }), text.size());
+    report_bytes("remove + erase (every other node of \"nodes\", scattered)", edit(times, [&](auto& copy) {
+        auto nodes = copy.find("nodes");
+        for (auto c = nodes.begin(); c < nodes.end(); c += 2) { copy.remove(c); }
+        copy.erase(copy.begin());
+    }), text.size());
+}
+
+static void bench_query(const std::string& text, std::size_t times) {
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+    const auto& ctree = tree;
+
+    const char* paths[] = {
+        "/asset/generator", "/scene", "/scenes/0/nodes/3",
+        "/meshes/*/name", "/meshes/*/primitives/*/attributes/POSITION", "/meshes/*/primitives/*/attributes/NORMAL",
+        "/meshes/*/primitives/*/attributes/TEXCOORD_0", "/meshes/*/primitives/*/material", "/meshes/*/primitives/*/indices",
+        "/materials/*/name", "/materials/*/pbrMetallicRoughness/baseColorTexture/index", "/accessors/*/count",
+        "/accessors/*/componentType", "/bufferViews/*/byteLength", "/nodes/*/mesh", "/nodes/*/translation/*",
+    };
+    std::vector<jxxson::document_path<>> compiled;
+    for (const char* path : paths) { compiled.emplace_back(path); }
+
+    std::size_t matched = 0;
+    const auto one_by_one = best_of(times, [&] {
+        matched = 0;
+        for (const auto& path : compiled) { matched += jxxson::select(ctree, path).size(); }
+    });
+    jxxson::document_query<jxxson::document_tree<>> batch;
+    for (const auto& path : compiled) { batch.add(path); }
+    const auto batched = best_of(times, [&] { batch.run(ctree); });
+
+    std::cout << "  " << std::size(paths) << " paths, " << matched << " matches\n";
+    report_ops("select, one path at a time (per path)", one_by_one, std::size(paths));
+    report_ops("document_query, all paths in one walk (per path)", batched, std::size(paths));
+}
+
+// The parts of a glTF document a loader needs first, read through document_schema.
+struct gltf_accessor {
+    std::size_t                        buffer_view    = 0;
+    int                                component_type = 0;
+    std::size_t                        count          = 0;
+    std::string                        type;
+    std::optional<std::vector<double>> min, max;
+};
+
+struct gltf_node {
+    std::optional<std::size_t>           mesh;
+    std::optional<std::array<double, 3>> translation;
+    std::vector<std::size_t>             children;
+};
+
+struct gltf_document {
+    std::vector<gltf_accessor> accessors;
+    std::vector<gltf_node>     nodes;
+};
+
+template <> struct jxxson::document_schema<gltf_accessor> {
+    static constexpr auto members = std::tuple{
+        document_member{"bufferView", &gltf_accessor::buffer_view}, document_member{"componentType", &gltf_accessor::component_type},
+        document_member{"count",      &gltf_accessor::count},       document_member{"type",          &gltf_accessor::type},
+        document_member{"min",        &gltf_accessor::min},         document_member{"max",           &gltf_accessor::max},
+    };
+};
+
+template <> struct jxxson::document_schema<gltf_node> {
+    static constexpr auto members = std::tuple{
+        document_member{"mesh", &gltf_node::mesh}, document_member{"translation", &gltf_node::translation}, document_member{"children", &gltf_node::children},
+    };
+};
+
+template <> struct jxxson::document_schema<gltf_document> {
+    static constexpr auto members = std::tuple{document_member{"accessors", &gltf_document::accessors}, document_member{"nodes", &gltf_document::nodes}};
+};
+
+static void bench_struct_mapping(const std::string& text, std::size_t times) {
+    using tree_type = jxxson::document_tree<>;
+    gltf_document doc;
+    const auto direct = best_of(times, [&] { doc = {}; jxxson::deserialize(text, doc); });
+
+    // The same structs filled from a parsed tree with find.
+    auto numbers = [](tree_type::const_iterator array, auto& out) {
+        for (auto e = array.begin(); e != array.end(); ++e) {
+            out.push_back(e->value().type == jxxson::document_tree_node_type::integer ? e->value().as<int>() : e->value().as<double>());
+        }
+    };
+    gltf_document walked;
+    const auto through_tree = best_of(times, [&] {
+        tree_type tree;
+        parser{tree}(text);
+        const tree_type& ctree = tree;
+        walked = {};
+        const auto accessors = ctree.find("accessors");
+        for (auto a = accessors.begin(); a != accessors.end(); ++a) {
+            gltf_accessor& out = walked.accessors.emplace_back();
+            if (auto v = a.find("bufferView");    v != ctree.end()) { out.buffer_view    = static_cast<std::size_t>(v->value().as<int>()); }
+            if (auto v = a.find("componentType"); v != ctree.end()) { out.component_type = v->value().as<int>(); }
+            if (auto v = a.find("count");         v != ctree.end()) { out.count          = static_cast<std::size_t>(v->value().as<int>()); }
+            if (auto v = a.find("type");          v != ctree.end()) { out.type           = v->value().as<std::string_view>(); }
+            if (auto v = a.find("min");           v != ctree.end()) { numbers(v, out.min.emplace()); }
+            if (auto v = a.find("max");           v != ctree.end()) { numbers(v, out.max.emplace()); }
+        }
+        const auto nodes = ctree.find("nodes");
+        for (auto n = nodes.begin(); n != nodes.end(); ++n) {
+            gltf_node& out = walked.nodes.emplace_back();
+            if (auto v = n.find("mesh"); v != ctree.end()) { out.mesh = static_cast<std::size_t>(v->value().as<int>()); }
+            if (auto v = n.find("translation"); v != ctree.end()) {
+                std::vector<double> t; numbers(v, t);
+                if (t.size() == 3) { out.translation = {t[0], t[1], t[2]}; }
+            }
+            if (auto v = n.find("children"); v != ctree.end()) { numbers(v, out.children); }
+        }
+    });
+
+    std::string out = jxxson::serialize(doc, jxxson::format_minified);
+    std::cout << "  " << doc.accessors.size() << " accessors, " << doc.nodes.size() << " nodes\n";
+    report_bytes("deserialize into structs", direct, text.size());
+    report_bytes("parse tree, then find into structs", through_tree, text.size());
+    report_bytes("serialize structs (minified)", best_of(times, [&] { out = jxxson::serialize(doc, jxxson::format_minified); }), out.size());
+}
+
+// Large glTF like document, most of it in two big arrays.
+static std::string large_corpus(std::size_t elements) {
+    std::string out = "{\"asset\":{\"version\":\"2.0\"},\"accessors\":[";
+    for (std::size_t i = 0; i != elements; ++i) {
+        out += (i ? ",{" : "{");
+        out += "\"bufferView\":" + std::to_string(i) + ",\"componentType\":5126,\"count\":" + std::to_string(i * 7 % 5000) +
+               ",\"max\":[1.5,2.25,-0.5],\"min\":[-1.5,0,-3.75],\"type\":\"VEC3\",\"name\":\"accessor \\\"" + std::to_string(i) + "\\\"\"}";
+    }
+    out += "],\"nodes\":[";
+    for (std::size_t i = 0; i != elements; ++i) {
+        out += (i ? ",{" : "{");
+        out += "\"mesh\":" + std::to_string(i) + ",\"translation\":[" + std::to_string(i % 100) + ".5,0.25,-1],\"children\":[]}";
+    }
+    return out + "]}";
+}
+
+// A few keys of a big document, read through an eager and a lazy tree.
+static void bench_lazy(const std::string& text, std::size_t times) {
+    std::size_t found = 0, nodes = 0;
+    auto read = [&](jxxson::document_tree<>& tree) {
+        found += tree.find("asset").find("generator") != tree.end();
+        found += tree.find("scenes").find(0).find("nodes").size();
+        found += tree.find("accessors").find(100).find("count") != tree.end();
+        nodes = tree.size();
+    };
+    report_bytes("parse, then three lookups", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree}(text);
+        read(tree);
+    }), text.size());
+    std::cout << "  " << nodes << " nodes\n";
+    report_bytes("lazy parse, then three lookups", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree, false, false, true}(text);
+        read(tree);
+    }), text.size());
+    std::cout << "  " << nodes << " nodes materialized, " << found << " found\n";
+}
+
+// Request threads reading one configuration document while a writer publishes new versions of it.
+static void bench_publisher(const std::string& text, std::size_t times) {
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+    jxxson::document_tree_publisher<jxxson::document_tree<>> publisher(std::move(tree));
+    constexpr std::size_t reads = 100000;
+    std::size_t           found = 0;
+    auto read = [&] {
+        for (std::size_t i = 0; i != reads; ++i) {
+            const auto version = publisher.read();
+            found += version->find("asset").find("generator") != version->end();
+        }
+    };
+    report_ops("read(), two lookups", best_of(times, read), reads);
+    report_bytes("update (copy, one change, publish)", best_of(times, [&] {
+        publisher.update([](jxxson::document_tree<>& next) { next.find("asset").find("version")->value() = "2.0"; });
+    }), text.size());
+    std::atomic<bool> stop = false;
+    std::thread       writer([&] {
+        while (!stop.load()) { publisher.update([](jxxson::document_tree<>& next) { next.find("scene")->value() = 0; }); }
+    });
+    report_ops("read(), two lookups, writer publishing", best_of(times, read), reads);
+    stop = true;
+    writer.join();
+    std::cout << "  version " << publisher.version() << ", " << publisher.reclaim() << " versions still pinned, " << found << " found\n";
+}
+
+static void bench_parallel(std::size_t times) {
+    const std::string text  = large_corpus(200000);
+    const std::size_t bytes = text.size();
+    std::cout << "parallel parse and format (" << bytes << " bytes, " << std::thread::hardware_concurrency() << " hardware threads)\n";
+    report_bytes("parse (contiguous, serial)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree}(text);
+    }), bytes);
+    report_bytes("structural pre-scan only", best_of(times, [&] {
+        jxxson::detail::find_split_points(jxxson::detail::select_scanner(), text.data(), text.data() + bytes, 16);
+    }), bytes);
+    for (const std::size_t threads : {1u, 2u, 4u, 8u, 16u}) {
+        report_bytes("parse_parallel, " + std::to_string(threads) + " threads", best_of(times, [&] {
+            jxxson::document_tree<> tree;
+            parser{tree}.parse_parallel(text, threads);
+        }), bytes);
+    }
+
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+    std::string out = tree.to_string(jxxson::format_minified);
+    report_bytes("to_string (minified, serial)", best_of(times, [&] { out = tree.to_string(jxxson::format_minified); }), out.size());
+    for (const std::size_t threads : {2u, 4u, 8u, 16u}) {
+        report_bytes("to_string (minified), " + std::to_string(threads) + " threads", best_of(times, [&] {
+            out = tree.to_string(jxxson::format_minified, threads);
+        }), out.size());
+    }
+
+    // Scans for a key/value pattern over every node.
+    const jxxson::document_tree<>& nodes = tree;
+    auto        pattern = [](const auto& n) { return n.value().type == jxxson::document_tree_node_type::integer && n.name() == "mesh"; };
+    std::size_t matches = 0;
+    report_ops("std::count_if over all nodes", best_of(times, [&] { matches = static_cast<std::size_t>(std::count_if(nodes.begin(), nodes.end(), pattern)); }), nodes.size());
+    for (const std::size_t threads : {1u, 2u, 4u, 8u, 16u}) {
+        report_ops("count_if, " + std::to_string(threads) + " threads", best_of(times, [&] {
+            if (jxxson::count_if(nodes, pattern, threads) != matches) { std::cout << "count_if mismatch\n"; }
+        }), nodes.size());
+    }
+    report_ops("transform_values (integers + 1), 4 threads", best_of(times, [&] {
+        jxxson::transform_values(tree, [](auto& n) { if (n.value().type == jxxson::document_tree_node_type::integer) { ++n.value().template as<int>(); } }, 4);
+    }), nodes.size());
+    std::cout << "  " << matches << " of " << nodes.size() << " nodes match\n";
+}
+
+static void bench_ndjson(std::size_t times) {
+    std::string text;
+    for (std::size_t i = 0; i != 100000; ++i) {
+        text += "{\"id\":" + std::to_string(i) + ",\"user\":\"user-" + std::to_string(i % 1000) +
+                "\",\"tags\":[\"a\",\"b\"],\"geo\":{\"lat\":" + std::to_string(i % 90) + ".5,\"lon\":-12.25},\"ok\":true}\n";
+    }
+    std::cout << "ndjson (100k records, " << text.size() << " bytes)\n";
+    std::size_t nodes = 0;
+    report_bytes("new tree and parser per record", best_of(times, [&] {
+        nodes = 0;
+        for (auto beg = text.data(), end = beg + text.size(); beg != end;) {
+            auto eol = std::find(beg, end, '\n');
+            jxxson::document_tree<> tree;
+            parser{tree}(beg, eol);
+            nodes += tree.size();
+            beg = eol == end ? end : eol + 1;
+        }
+    }), text.size());
+    report_bytes("document_ndjson_reader", best_of(times, [&] {
+        nodes = 0;
+        jxxson::document_ndjson_reader<> reader(text);
+        while (reader.next()) { nodes += reader.tree().size(); }
+    }), text.size());
+    const std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<std::size_t> shared_nodes = 0;
+    report_bytes("parse_ndjson, " + std::to_string(threads) + " threads", best_of(times, [&] {
+        jxxson::parse_ndjson(text, [&](auto& reader) { shared_nodes += reader.tree().size(); }, threads);
+    }), text.size());
+}
+
+static void bench_snapshot(std::size_t times) {
+    const std::string text = large_corpus(200000);
+    const auto        path = std::filesystem::temp_directory_path() / "jxxson_bench.snap";
+    jxxson::document_tree<> tree;
+    parser{tree}(text);
+    std::cout << "snapshot (" << text.size() << " bytes json, " << tree.size() << " nodes)\n";
+    report_ops("save_snapshot", best_of(times, [&] { jxxson::save_snapshot(tree, path); }), tree.size());
+    std::cout << "  file size " << std::filesystem::file_size(path) << " bytes\n";
+    std::size_t visited = 0;
+    report_bytes("parse text, walk", best_of(times, [&] {
+        jxxson::document_tree<> parsed;
+        parser{parsed}(text);
+        visited = 0;
+        for (const auto& node : parsed) { visited += node.value().type == jxxson::document_tree_node_type::string; }
+    }), text.size());
+    report_bytes("open snapshot, walk", best_of(times, [&] {
+        const jxxson::document_tree_snapshot<> snap(path);
+        visited = 0;
+        for (const auto& node : snap) { visited += node.value().type == jxxson::document_tree_node_type::string; }
+    }), text.size());
+    report_ops("open snapshot, one lookup", best_of(times, [&] {
+        const jxxson::document_tree_snapshot<> snap(path);
+        visited += snap.find("accessors") != snap.end();
+    }), 1);
+    std::cout << "  " << visited << " strings\n";
+    std::filesystem::remove(path);
+}
+
+int main(int argc, char** argv) {
+    const char*       path  = argc > 1 ? argv[1] : "test.json";
+    const std::size_t times = 10;
+
+    std::ifstream     in_json(path);
+    std::stringstream ss; ss << in_json.rdbuf();
+    const std::string text = ss.str();
+
+    const std::pair<const char*, std::string> corpora[] = {
+        {path,                                       text},
+        {"deep nesting (256 x depth 256)",           deep_corpus(256, 256)},
+        {"wide objects (64 x 1024 keys)",            wide_corpus(64, 1024)},
+        {"number heavy (200k numbers)",              number_corpus(200000)},
+        {"geometry (20k glTF nodes)",                geometry_corpus(20000)},
+        {"string heavy (50k strings)",               string_corpus(50000, false)},
+        {"escape heavy (50k strings)",               string_corpus(50000, true)},
+    };
+    for (const auto& [name, corpus] : corpora) {
+        std::cout << name << " (" << corpus.size() << " bytes)\n";
+        bench_parse_and_format(corpus, times);
+    }
+
+    std::cout << "load " << path << "\n";
+    report_bytes("load (ifstream + streambuf)", best_of(times, [&] {
+        std::ifstream           in(path);
+        jxxson::document_tree<> tree;
+        parser{tree}(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }), text.size());
+    report_bytes("load (load_file, mapped)", best_of(times, [&] {
+        jxxson::document_tree<> tree;
+        parser{tree}.load_file(path);
+    }), text.size());
+
+    std::cout << "tree api on " << path << "\n";
+    bench_tree_api(text, times);
+
+    std::cout << "query on " << path << "\n";
+    bench_query(text, times);
+
+    std::cout << "struct mapping on " << path << "\n";
+    bench_struct_mapping(text, times);
+
+    std::cout << "selective reads on " << path << "\n";
+    bench_lazy(text, times);
+
+    std::cout << "shared versions of " << path << "\n";
+    bench_publisher(text, times);
+
+    std::cout << "lookup\n";
+    bench_lookup(times);
+
+    bench_ndjson(times);
+
+    bench_parallel(3);
+
+    bench_snapshot(3);
+}
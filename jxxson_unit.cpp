@@ -0,0 +1,883 @@
+//
+// MIT License
+//
+// Copyright (c) 2025 Henry Du
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <list>
+#include <memory_resource>
+#include <mutex>
+#include <thread>
+
+#include "jxxson.hpp"
+
+using tree_type = jxxson::document_tree<>;
+using parser    = jxxson::document_tree_parser<>;
+using node_type = jxxson::document_tree_node_type;
+
+static int failures = 0;
+
+#define CHECK(...) do { if (!(__VA_ARGS__)) { ++failures; std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #__VA_ARGS__ ") failed\n"; } } while (false)
+
+static std::string read_file(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Contiguous input goes through the block scanners.
+static tree_type parse(std::string_view json) {
+    tree_type tree;
+    parser{tree}(json);
+    return tree;
+}
+
+// Character by character, through the generic iterator path.
+static tree_type parse_stream(const std::string& json) {
+    tree_type          tree;
+    std::istringstream in(json);
+    parser{tree}(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return tree;
+}
+
+static std::string minified(const auto& tree) {
+    const auto str = tree.to_string(jxxson::format_minified);
+    return std::string(str.begin(), str.end());
+}
+
+// Parents come before their children and children of one parent are contiguous.
+static bool is_breadth_first(const tree_type& tree) {
+    return std::ranges::is_sorted(tree.begin() + 1, tree.end(), std::less<>(), [](const auto& n) { return n.parent_index(); });
+}
+
+template <class Exception>
+static bool throws(auto&& fn) {
+    try { fn(); } catch (const Exception&) { return true; }
+    return false;
+}
+
+struct unit_node {
+    std::string                          name;
+    std::optional<std::array<double, 3>> translation;
+    std::vector<std::size_t>             children;
+    bool                                 visible = true;
+};
+
+struct unit_scene {
+    std::vector<unit_node>     nodes;
+    std::int64_t               id = 0;
+    std::optional<std::string> note;
+};
+
+template <> struct jxxson::document_schema<unit_node> {
+    static constexpr auto members = std::tuple{document_member{"name", &unit_node::name}, document_member{"translation", &unit_node::translation},
+                                               document_member{"children", &unit_node::children}, document_member{"visible", &unit_node::visible}};
+};
+
+template <> struct jxxson::document_schema<unit_scene> {
+    static constexpr auto members = std::tuple{document_member{"nodes", &unit_scene::nodes}, document_member{"id", &unit_scene::id},
+                                               document_member{"note", &unit_scene::note}};
+};
+
+///////////////////////////////////////////////////////////////////////////////////
+///                                Parsing                                      ///
+///////////////////////////////////////////////////////////////////////////////////
+
+static void test_relayout(const std::string& corpus) {
+    for (const std::string& json : {corpus, std::string(R"({"a":{"b":{"c":[1,{"d":[]},[[2]]]}},"e":[{},{"f":3}],"g":"h"})")}) {
+        const tree_type tree = parse(json), streamed = parse_stream(json);
+        CHECK(is_breadth_first(tree));
+        CHECK(minified(tree) == minified(streamed));
+    }
+    const tree_type tree = parse(R"({"a":{"b":1},"c":[2,3]})");
+    CHECK(tree.size() == 7);
+    CHECK(tree.find("a").find("b")->value().as<int>() == 1);
+    CHECK(tree.find("c").size() == 2);
+}
+
+static void test_scanner() {
+    // Strings of every length around the 64 byte blocks, with quotes and backslashes near block edges.
+    std::string json = "[";
+    for (std::size_t n = 0; n != 140; ++n) {
+        const std::string s = n > 2 ? std::string(n / 2, 'x') + "\\\"" + std::string(n - n / 2 - 1, 'x') : std::string(n, 'x');
+        json += (n != 0 ? ",\"" : "\"") + s + "\"";
+    }
+    json += "]";
+    const tree_type tree = parse(json);
+    CHECK(tree.root().size() == 140);
+    CHECK(minified(tree) == json);
+    CHECK(minified(tree) == minified(parse_stream(json)));
+    // Parsing stops at the first character that can not start a value.
+    tree_type  stopped;
+    const auto text = std::string_view(R"({"a":1} x)");
+    CHECK(parser{stopped}(text) == text.begin() + 8);
+}
+
+// A closer with nothing open stops the parse there, the values before it are kept.
+static void test_unbalanced() {
+    const std::pair<std::string_view, std::size_t> inputs[] = {{"]]", 0}, {"}", 0}, {"{}]]", 2}, {"{}]]{\"a\":1}", 2}, {"[1,2]]]", 5}, {"{\"a\":[1]}}]", 9}};
+    for (const auto& [json, stop] : inputs) {
+        for (const bool pack : {false, true}) {
+            tree_type tree;
+            parser    p{tree};
+            p.pack_arrays = pack;
+            CHECK(p(json) == json.begin() + stop);
+        }
+        CHECK(minified(parse_stream(std::string(json))) == minified(parse(json)));
+        jxxson::document_tree_view<> view;
+        CHECK(jxxson::document_tree_view_parser<>{view}(json) == json.data() + stop);
+        CHECK(minified(view) == minified(parse(json)));
+    }
+    CHECK(minified(parse("[1,2]]]")) == "[1,2]");
+}
+
+static void test_parse_parallel(const std::string& corpus) {
+    auto parse_parallel = [](std::string_view json, tree_type& tree) { return parser{tree}.parse_parallel(json.begin(), json.end(), 4, {}, 256) - json.begin(); };
+    tree_type tree;
+    CHECK(parse_parallel(corpus, tree) == static_cast<std::ptrdiff_t>(corpus.size()));
+    CHECK(is_breadth_first(tree));
+    CHECK(minified(tree) == minified(parse(corpus)));
+    // Trees in an arena are parsed serially, an arena is not thread safe.
+    jxxson::pmr::document_arena  arena(1 << 16, std::pmr::new_delete_resource());
+    jxxson::pmr::document_tree<> in_arena(1024, &arena, &arena);
+    CHECK(jxxson::pmr::document_tree_parser<>{in_arena}.parse_parallel(corpus.begin(), corpus.end(), 4, &arena, 256) == corpus.end());
+    CHECK(minified(in_arena) == minified(tree));
+
+    // Extra closers in any part stop the parse where a serial parse stops.
+    std::string items;
+    for (std::size_t i = 0; i != 400; ++i) { items += (i != 0 ? ",{\"k\":[" : "{\"k\":[") + std::to_string(i) + R"(,{"x":"y"}]})"; }
+    const std::size_t half = items.find(",{", items.size() / 2);
+    for (const std::string& json : {"[" + items.substr(0, half) + "]]," + items.substr(half + 1) + "]",
+                                    "[" + items.substr(0, half) + "]]]" + items.substr(half) + "]",
+                                    "[[" + items + "]]]]"}) {
+        tree_type         serial, parallel;
+        const std::size_t stop = static_cast<std::size_t>(parser{serial}(json) - json.begin());
+        CHECK(stop < json.size());
+        CHECK(parse_parallel(json, parallel) == static_cast<std::ptrdiff_t>(stop));
+        CHECK(minified(parallel) == minified(serial));
+    }
+}
+
+static void test_escapes() {
+    const std::string json = R"(["a\nb\t\"q\"\\\/", "\u00e9\u4e2d", "\ud83d\ude00", "\ud83d!", {"k\u0041y":1}])";
+    for (const tree_type& tree : {parse(json), parse_stream(json)}) {
+        CHECK(tree.root().find(0)->value().as<std::string_view>() == "a\nb\t\"q\"\\/");
+        CHECK(tree.root().find(1)->value().as<std::string_view>() == "\xC3\xA9\xE4\xB8\xAD");
+        CHECK(tree.root().find(2)->value().as<std::string_view>() == "\xF0\x9F\x98\x80");
+        CHECK(tree.root().find(3)->value().as<std::string_view>() == "\xEF\xBF\xBD!");  // Lone surrogate.
+        CHECK(tree.root().find(4).find("kAy")->value().as<int>() == 1);
+        CHECK(minified(tree) == "[\"a\\nb\\t\\\"q\\\"\\\\/\",\"\xC3\xA9\xE4\xB8\xAD\",\"\xF0\x9F\x98\x80\",\"\xEF\xBF\xBD!\",{\"kAy\":1}]");
+    }
+    // Unterminated strings and escapes at the end of input keep what was read.
+    for (const std::string truncated : {R"("abc)", R"("\u12)", R"("ab\)", R"({"abc)", R"({"a":"b)", R"(["x",)"}) {
+        std::list<char>   chars(truncated.begin(), truncated.end());
+        tree_type         listed;
+        parser{listed}(chars.begin(), chars.end());
+        CHECK(minified(listed) == minified(parse_stream(truncated)));
+    }
+    CHECK(parse_stream(R"(["ab\)").root().find(0)->value().as<std::string_view>() == "ab\\");
+
+    // Validation stops at the first byte that is not well formed UTF-8.
+    const std::string bad = "[\"ok\",\"\xC3\x28\"]";
+    tree_type         checked;
+    CHECK(parser{checked, true}(bad) == bad.begin() + 7);
+    CHECK(jxxson::find_invalid_utf8(bad) == 7);
+    CHECK(jxxson::find_invalid_utf8("\xF0\x9F\x98\x80 \xED\xA0\x80") == 5);  // Encoded surrogate.
+}
+
+static void test_numbers() {
+    // Numbers no number type holds keep their text, every other number reads back to the same value.
+    const std::string json     = "[0,2147483647,-2147483648,2147483648,18446744073709551616,123456789012345678901234,1e400,-1e400,1e-400,0.1,15e2]";
+    const std::string expected = "[0,2147483647,-2147483648,2147483648,18446744073709551616,123456789012345678901234,1e400,-1e400,1e-400,0.1,1500.0]";
+    for (const tree_type& tree : {parse(json), parse_stream(json)}) {
+        CHECK(minified(tree) == expected);
+        CHECK(tree.root().find(1)->value().as<int>() == std::numeric_limits<int>::max());
+        CHECK(tree.root().find(2)->value().as<int>() == std::numeric_limits<int>::min());
+        CHECK(tree.root().find(3)->value().type == node_type::floating_point && tree.root().find(3)->value().literal());
+        CHECK(tree.root().find(3)->value().as<double>() == 2147483648.0);
+        CHECK(tree.root().find(6)->value().as<double>() == std::numeric_limits<double>::infinity());
+        CHECK(tree.root().find(8)->value().as<double>() == 0.0 && tree.root().find(8)->value().literal_text() == "1e-400");
+        CHECK(!tree.root().find(9)->value().literal() && !tree.root().find(10)->value().literal());
+    }
+    for (const std::string bad : {"[01]", "[-]", "[1.]", "[.5]", "[1e]", "[1e+]", "[-a]"}) {
+        tree_type stopped;
+        CHECK(parser{stopped}(bad) != bad.end());
+    }
+
+    // The text survives copies, the view, snapshots and the streaming parser.
+    tree_type copy = parse(json);
+    CHECK(minified(tree_type(copy)) == expected);
+    jxxson::document_tree_view<> view;
+    jxxson::document_tree_view_parser<>{view}(json);
+    CHECK(minified(view) == expected);
+    const auto path = std::filesystem::temp_directory_path() / "jxxson_unit_numbers.snap";
+    jxxson::save_snapshot(copy, path);
+    {
+        const jxxson::document_tree_snapshot<> snap(path);
+        CHECK(snap.verify() && minified(snap) == expected);
+        CHECK(snap.root().find(3)->value().literal() && snap.root().find(3)->value().as<double>() == 2147483648.0);
+    }
+    std::filesystem::remove(path);
+    tree_type                                 built;
+    jxxson::document_tree_builder<tree_type>  builder(built);
+    jxxson::document_sax_parser<decltype(builder)> sax(builder);
+    for (std::size_t i = 0; i < json.size(); i += 5) { sax.feed(json.data() + i, json.data() + std::min(i + 5, json.size())); }
+    CHECK(sax.finish() && builder.done() && minified(built) == expected);
+
+    // Writing through as<double>() replaces the text with the closest double.
+    copy.root().find(3)->value().as<double>() *= 2;
+    CHECK(!copy.root().find(3)->value().literal() && minified(copy).starts_with("[0,2147483647,-2147483648,4294967296.0,"));
+
+    // Arrays with such a number are not packed.
+    tree_type packed;
+    parser    p{packed};
+    p.pack_arrays = true;
+    p("[[1,2,3],[1,2,3000000000],[1.5,1e400]]");
+    CHECK(packed.root().find(0)->value().packed() && !packed.root().find(1)->value().packed() && !packed.root().find(2)->value().packed());
+    CHECK(minified(packed) == "[[1,2,3],[1,2,3000000000],[1.5,1e400]]");
+}
+
+// Records every event of the streaming parser as text.
+struct event_log {
+    std::string events;
+    void on_start_object() { events += '{'; }
+    void on_end_object()   { events += '}'; }
+    void on_start_array()  { events += '['; }
+    void on_end_array()    { events += ']'; }
+    void on_key(std::string_view key) { events += "k:" + std::string(key) + ' '; }
+    template <class Value>
+    void on_value(const Value& v) {
+        switch (v.type) {
+        case node_type::boolean:        events += v.template as<bool>() ? "true " : "false "; break;
+        case node_type::integer:        events += std::to_string(v.template as<int>()) + ' '; break;
+        case node_type::floating_point: events += v.literal() ? std::string(v.literal_text()) + ' ' : std::to_string(v.template as<double>()) + ' '; break;
+        case node_type::string:         events += "s:" + std::string(v.template as<std::string_view>()) + ' '; break;
+        default:                        events += "null "; break;
+        }
+    }
+    void on_end_document() { events += "| "; }
+};
+
+// Tokens cut at any byte resume in the next chunk, the events do not depend on where the input is split.
+static void test_sax(const std::string& corpus) {
+    const std::string json = R"( {"k\u0041y":[true,false,null,-12,3.25e1,"a\"b\u00e9",1e400],"":{}} [7] 8)";
+    auto events = [&](std::size_t chunk) {
+        event_log                              log;
+        jxxson::document_sax_parser<event_log> sax(log);
+        for (std::size_t i = 0; i < json.size(); i += chunk) {
+            const char* end = json.data() + std::min(i + chunk, json.size());
+            CHECK(sax.feed(json.data() + i, end) == end);
+        }
+        CHECK(sax.finish() && sax.offset() == json.size());
+        return log.events;
+    };
+    const std::string whole = events(json.size());
+    CHECK(whole == "{k:kAy [true false null -12 32.500000 s:a\"b\xC3\xA9 1e400 ]k: {}}| [7 ]| 8 | ");
+    for (std::size_t chunk = 1; chunk != 12; ++chunk) { CHECK(events(chunk) == whole); }
+
+    // The builder gives the tree the tree parser gives, also read through a stream in small blocks.
+    tree_type                                       built;
+    jxxson::document_tree_builder<tree_type>        builder(built);
+    jxxson::document_sax_parser<decltype(builder)> sax(builder);
+    std::istringstream                              in(corpus);
+    CHECK(sax.parse(in, 1000) && builder.done() && minified(built) == minified(parse(corpus)));
+
+    // An error is reported at its offset in the stream, even when found in a later chunk, and sticks until reset().
+    const std::string bad = R"({"a":[1,2}})";
+    event_log                              log;
+    jxxson::document_sax_parser<event_log> strict(log);
+    CHECK(strict.feed(bad.data(), bad.data() + 6) == bad.data() + 6);
+    CHECK(strict.feed(bad.data() + 6, bad.data() + bad.size()) == bad.data() + 9 && strict.failed() && strict.offset() == 9);
+    CHECK(strict.feed(bad.data(), bad.data() + 1) == bad.data() && !strict.finish());
+    strict.reset();
+    CHECK(strict.feed(json) == json.data() + json.size() && strict.finish());
+    // Input that ends inside a value is not complete.
+    jxxson::document_sax_parser<event_log> cut(log);
+    CHECK(cut.feed(json.data(), json.data() + 20) == json.data() + 20 && !cut.finish());
+}
+
+// Records reuse one tree, blank lines are skipped but counted.
+static void test_ndjson() {
+    const std::string input = "{\"a\":1}\n\n  \n[1,2,{\"b\":\"a string longer than any small buffer\"}]\r\n{\"c\":1} x\n[7]";
+    jxxson::document_ndjson_reader<> reader(input);
+    std::vector<std::tuple<std::size_t, bool, std::string>> records;
+    while (reader.next()) { records.emplace_back(reader.line(), reader.valid(), reader.valid() ? minified(reader.tree()) : std::string(reader.record())); }
+    CHECK(records == decltype(records){{1, true, R"({"a":1})"}, {4, true, R"([1,2,{"b":"a string longer than any small buffer"}])"},
+                                       {5, false, R"({"c":1} x)"}, {6, true, "[7]"}});
+
+    // Slices on threads see every record once, with the line it has in the whole input.
+    std::string many;
+    for (std::size_t i = 0; i != 5000; ++i) {
+        if (i % 7 == 3) { many += '\n'; }
+        many += R"({"id":)" + std::to_string(i) + R"(,"pad":"xxxxxxxxxxxxxxxx"})" "\n";
+    }
+    std::vector<std::size_t> lines(5000, 0);
+    std::mutex               lock;
+    jxxson::parse_ndjson(many, [&](auto& r) {
+        const std::size_t id = static_cast<std::size_t>(r.tree().find("id")->value().template as<int>());
+        std::lock_guard   guard(lock);
+        lines[id] = r.valid() ? r.line() : 0;
+    }, 4);
+    bool in_order = true;
+    for (std::size_t i = 0, line = 1; i != lines.size(); ++i, ++line) { line += i % 7 == 3; in_order = in_order && lines[i] == line; }
+    CHECK(in_order);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+///                                 Lookups                                     ///
+///////////////////////////////////////////////////////////////////////////////////
+
+static void test_view(const std::string& corpus) {
+    const tree_type           tree = parse(corpus);
+    jxxson::document_tree_view<> view;
+    jxxson::document_tree_view_parser<>{view}(corpus);
+    CHECK(view.size() == tree.size());
+    CHECK(minified(view) == minified(tree));
+    CHECK(view["asset"]["generator"]->value().as<std::string_view>() == tree.find("asset").find("generator")->value().as<std::string_view>());
+    CHECK(view["accessors"][3]["count"]->value().as<int>() == tree.find("accessors").find(3).find("count")->value().as<int>());
+
+    // Parsing again replaces the nodes and decoded strings, clear() leaves only the root.
+    jxxson::document_tree_view_parser<>{view}(corpus);
+    CHECK(view.size() == tree.size() && minified(view) == minified(tree));
+    view.clear();
+    CHECK(view.size() == 1 && view.root() == view.end() && minified(view).empty());
+}
+
+static void test_child_and_key_index(const std::string& corpus) {
+    tree_type tree = parse(corpus), plain = parse(corpus);
+    plain.child_index(false);
+    tree.key_index_threshold(4);
+    for (std::size_t i = 0; i != 20; ++i) {
+        const auto a = tree.find("accessors")[i];
+        const auto b = std::as_const(plain).find("accessors")[i];
+        CHECK(a.size() == b.size());
+        CHECK(a->value().type == b->value().type);
+        CHECK(tree.find("accessors")[i]["componentType"]->value().as<int>() == b["componentType"]->value().as<int>());
+    }
+    CHECK(tree.find("accessors")[0].find("no such key") == tree.end());
+    // Emplacing keeps the tables in sync.
+    tree.find("accessors")[0].emplace("extra", 7);
+    CHECK(tree.find("accessors")[0]["extra"]->value().as<int>() == 7);
+    CHECK(minified(plain) == minified(parse(corpus)));
+}
+
+static void test_load_file(const std::string& corpus) {
+    const auto path = std::filesystem::temp_directory_path() / "jxxson_unit_load.json";
+    std::ofstream(path, std::ios::binary) << corpus;
+    tree_type tree;
+    CHECK(parser{tree}.load_file(path) == corpus.size());
+    CHECK(minified(tree) == minified(parse(corpus)));
+    std::filesystem::remove(path);
+
+#if defined(JXXSON_POSIX_MMAP)
+    // A pipe reports no size, it is read into a buffer in many short reads.
+    int fds[2];
+    CHECK(::pipe(fds) == 0);
+    std::thread writer([&] {
+        for (std::size_t at = 0; at < corpus.size();) {
+            const ::ssize_t n = ::write(fds[1], corpus.data() + at, corpus.size() - at);
+            if (n <= 0) { break; }
+            at += static_cast<std::size_t>(n);
+        }
+        ::close(fds[1]);
+    });
+    {
+        const jxxson::mapped_file piped("/dev/fd/" + std::to_string(fds[0]));
+        CHECK(!piped.mapped() && std::string_view(piped.data(), piped.size()) == corpus);
+    }
+    writer.join();
+    ::close(fds[0]);
+#endif
+}
+
+// A batch of inserts gives the same tree as emplacing them one by one.
+static void test_edit() {
+    const std::string json = R"({"a":{"b":[1,2],"c":"x"},"d":[{"e":3}],"f":4})";
+    tree_type         tree = parse(json), one_by_one = parse(json);
+    const auto        a_at = tree.find("a") - tree.begin(), d_at = tree.find("d") - tree.begin();
+
+    jxxson::document_tree_edit<tree_type> edit(tree);
+    const auto g = edit.emplace(tree.find("d").find(0), "g", tree_type::node_value(jxxson::document_node_object_tag));
+    const auto h = edit.emplace(g, "h", tree_type::node_value(5));
+    edit.emplace(tree.find("a").find("b"), "", tree_type::node_value(6));
+    edit.emplace(tree.root(), "i", tree_type::node_value(true));
+    CHECK(!edit.emplace(tree.find("f"), "j", tree_type::node_value(7)).valid() && !edit.emplace(h, "k", tree_type::node_value(8)).valid());
+    CHECK(edit.size() == 4);
+    tree.apply(edit);
+
+    one_by_one.find("d").find(0).emplace("g", tree_type::node_value(jxxson::document_node_object_tag)).emplace("h", 5);
+    one_by_one.find("a").find("b").emplace("", 6);
+    one_by_one.root().emplace("i", true);
+    CHECK(is_breadth_first(tree) && minified(tree) == minified(one_by_one));
+    CHECK(minified(tree) == R"({"a":{"b":[1,2,6],"c":"x"},"d":[{"e":3,"g":{"h":5}}],"f":4,"i":true})");
+    // Nodes not deeper than the shallowest edited parent keep their indices.
+    CHECK(tree.find("a") - tree.begin() == a_at && tree.find("d") - tree.begin() == d_at);
+    CHECK((tree.begin() + static_cast<std::ptrdiff_t>(edit.index(h)))->value().as<int>() == 5);
+    CHECK(tree.find("d").find(0).find("g").find("h")->value().as<int>() == 5);
+}
+
+// Removed nodes and everything below them go in one compaction, the rest keeps its order and parents.
+static void test_erase(const std::string& corpus) {
+    tree_type tree = parse(R"({"a":{"b":[1,{"c":2}],"d":3},"e":[4,5,6],"f":{"g":{"h":7}},"i":8})");
+    tree.key_index_threshold(1);
+    CHECK(tree.find("f").find("g").find("h")->value().as<int>() == 7);
+    tree.remove(tree.find("a").find("b"));
+    tree.remove(tree.find("e").find(1));
+    tree.remove(tree.find("f").find("g"));
+    tree.erase(tree.begin());
+    CHECK(is_breadth_first(tree) && tree.size() == 9);
+    CHECK(minified(tree) == R"({"a":{"d":3},"e":[4,6],"f":{},"i":8})");
+    CHECK(tree.find("a").find("d")->value().as<int>() == 3 && tree.find("f").find("g") == tree.end() && tree.find("e").size() == 2);
+
+    // Removing a whole subtree of the corpus leaves what an input without it parses to.
+    std::string       expected = minified(parse(corpus));
+    const std::size_t first    = expected.find(",\"accessors\":[");
+    std::size_t       last     = expected.find('[', first);
+    for (int depth = 0; (depth += expected[last] == '[' ? 1 : expected[last] == ']' ? -1 : 0) != 0;) { ++last; }
+    expected.erase(first, last + 1 - first);
+    tree_type big = parse(corpus);
+    big.remove(big.find("accessors"));
+    big.erase(big.begin());
+    CHECK(is_breadth_first(big) && big.find("accessors") == big.end());
+    CHECK(minified(big) == expected && big.size() == parse(expected).size());
+}
+
+static void test_query(const std::string& corpus) {
+    const std::string json = R"({"a/b":{"m~n":1},"c":[{"d":2},{"d":3},{"e":4}],"0":{"1":5},"f":[6]})";
+    const tree_type   tree = parse(json);
+    auto values = [&](std::string_view path) {
+        std::vector<int> out;
+        for (const auto& n : jxxson::select(tree, jxxson::document_path<>(path))) { out.push_back(n->value().as<int>()); }
+        return out;
+    };
+    CHECK(values("/a~1b/m~0n") == std::vector<int>{1});
+    CHECK(values("/c/*/d") == std::vector<int>{2, 3} && values("/c/1/d") == std::vector<int>{3});
+    CHECK(values("/0/1") == std::vector<int>{5});  // Indices match object keys too.
+    CHECK(values("/c/3/d").empty() && values("/c/-").empty() && values("/f/00").empty() && values("/x").empty());
+    CHECK(jxxson::select(tree, jxxson::document_path<>("")).front() == tree.root());
+    CHECK(jxxson::select_first(tree, jxxson::document_path<>("/c/*")) == tree.find("c").find(0));
+    CHECK(jxxson::select_first(tree, jxxson::document_path<>("/c/*/x")) == tree.end());
+    CHECK(jxxson::document_path<>("/*", false).steps().front().name == "*");
+    CHECK(throws<std::invalid_argument>([] { jxxson::document_path<>("a"); }) && throws<std::invalid_argument>([] { jxxson::document_path<>("/a~2"); }));
+
+    // A batch shares prefixes, every path gets what it gets alone, on the view too.
+    const tree_type              big = parse(corpus);
+    jxxson::document_tree_view<> view;
+    jxxson::document_tree_view_parser<>{view}(corpus);
+    const std::string_view       paths[] = {"/accessors/*/count", "/accessors/3/count", "/asset/generator", "/meshes/0/primitives/*/attributes/POSITION", "/nope"};
+    jxxson::document_query<tree_type>                    query;
+    jxxson::document_query<jxxson::document_tree_view<>> view_query;
+    for (const auto path : paths) { query.add(path); view_query.add(path); }
+    query.run(big);
+    view_query.run(view);
+    for (std::size_t id = 0; id != std::size(paths); ++id) {
+        const auto alone = jxxson::select(big, jxxson::document_path<>(paths[id]));
+        CHECK(query.results(id) == alone && view_query.results(id).size() == alone.size());
+    }
+    CHECK(query.results(0).size() == big.find("accessors").size() && query.results(1).front() == big.find("accessors").find(3).find("count"));
+    CHECK(query.results(4).empty());
+}
+
+// Counts what reaches the default resource, a tree in an arena should never get there.
+struct counting_resource : std::pmr::memory_resource {
+    std::size_t count = 0;
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override { ++count; return std::pmr::new_delete_resource()->allocate(bytes, alignment); }
+    void  do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override { std::pmr::new_delete_resource()->deallocate(p, bytes, alignment); }
+    bool  do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+static void test_packed() {
+    const std::string json = R"({"a":{"m":[1.5,2.5,3.5],"i":[4,5,6],"s":["x",7]}})";
+    tree_type         tree;
+    parser            p{tree};
+    p.pack_arrays = true;
+    p(json);
+    const tree_type& read = tree;
+    const auto       m    = read.find("a").find("m");
+    CHECK(m->value().packed() && m.size() == 0);
+    CHECK(m.element(1)->as<double>() == 2.5 && !m.element(3));
+    CHECK(read.find("a").find("i").element(2)->as<int>() == 6);
+    CHECK(read.find("a").find("s").element(0)->as<std::string_view>() == "x" && read.find("a").find("s").element(1)->as<int>() == 7);
+
+    // Index lookups and paths below a packed array throw instead of finding nothing, the algorithms see the elements.
+    bool threw = false;
+    try { m.find(0); } catch (const std::logic_error&) { threw = true; }
+    CHECK(threw);
+    threw = false;
+    try { jxxson::select(read, jxxson::document_path<>("/a/m/1")); } catch (const std::logic_error&) { threw = true; }
+    CHECK(threw);
+    CHECK(jxxson::select(read, jxxson::document_path<>("/a/m")).size() == 1);
+    const auto is_number = [](const auto& n) { return n.value().type == node_type::integer || n.value().type == node_type::floating_point; };
+    CHECK(jxxson::count_if(read, is_number) == 7 && jxxson::count_if(read, is_number, 4) == 7);
+    CHECK(jxxson::count_if(parse(json), is_number) == 7);
+    CHECK(jxxson::find_if(read, [](const auto& n) { return n.value().type == node_type::integer && n.value().template as<int>() == 5; }) == read.find("a").find("i"));
+
+    // Single elements change in place through the span, transform_values unpacks so elements may change their type.
+    tree.find("a").find("m")->value().as<std::span<double>>()[0] = 0.5;
+    CHECK(tree.find("a").find("m")->value().packed());
+    jxxson::transform_values(tree, [](auto& n) {
+        if (n.value().type == node_type::integer) { n.value() = tree_type::node_value(n.value().template as<int>() * 0.5); }
+    });
+    CHECK(!read.find("a").find("i")->value().packed() && is_breadth_first(tree));
+    CHECK(minified(tree) == R"({"a":{"m":[0.5,2.5,3.5],"i":[2.0,2.5,3.0],"s":["x",3.5]}})");
+}
+
+static void test_lazy(const std::string& corpus) {
+    const tree_type   eager    = parse(corpus);
+    const std::string expected = minified(eager);
+    tree_type         tree;
+    parser            p{tree};
+    p.lazy = true;
+    p(corpus);
+    const tree_type& read = tree;
+    CHECK(tree.deferred() && minified(tree) == expected);
+
+    // Const access can not materialize, it throws instead of seeing empty containers.
+    const auto always = [](const auto&) { return true; };
+    CHECK(throws<std::logic_error>([&] { read.find("asset").find("generator"); }));
+    CHECK(throws<std::logic_error>([&] { read.find("accessors").size(); }));
+    CHECK(throws<std::logic_error>([&] { read.find("accessors").element(0); }));
+    CHECK(throws<std::logic_error>([&] { jxxson::select(read, jxxson::document_path<>("/accessors/0/count")); }));
+    CHECK(throws<std::logic_error>([&] { jxxson::count_if(read, always); }));
+    CHECK(throws<std::logic_error>([&] { jxxson::transform_values(tree, [](auto&) {}); }));
+    CHECK(jxxson::select(read, jxxson::document_path<>("/asset")).size() == 1);
+
+    // A mutable lookup materializes the whole subtree, lookups below it change nothing.
+    const auto count = eager.find("accessors").find(3).find("count")->value().as<int>();
+    CHECK(tree.find("accessors")[3]["count"]->value().as<int>() == count);
+    const auto at = tree.find("accessors")[3] - tree.begin();
+    const auto size = tree.size();
+    CHECK(tree.find("accessors")[5]["type"]->value().as<std::string_view>() == eager.find("accessors").find(5).find("type")->value().as<std::string_view>());
+    CHECK(tree.size() == size && tree.find("accessors")[3] - tree.begin() == at);
+    CHECK(read.find("accessors").find(3).find("count")->value().as<int>() == count);
+    CHECK(tree.deferred() && is_breadth_first(tree));
+
+    tree.materialize();
+    CHECK(!tree.deferred() && is_breadth_first(tree) && minified(tree) == expected);
+    CHECK(jxxson::count_if(read, always) == jxxson::count_if(eager, always));
+
+    // Published versions are materialized, readers only have const access.
+    tree_type again;
+    parser    q{again};
+    q.lazy = true;
+    q(corpus);
+    jxxson::document_tree_publisher<tree_type> publisher(std::move(again));
+    CHECK(publisher.read()->find("asset").find("generator")->value().as<std::string_view>() == eager.find("asset").find("generator")->value().as<std::string_view>());
+}
+
+static void test_arena(const std::string& corpus) {
+    counting_resource           counter;
+    std::pmr::memory_resource*  previous = std::pmr::set_default_resource(&counter);
+    jxxson::pmr::document_arena arena(1 << 16, std::pmr::new_delete_resource());
+    const std::string           expected = minified(parse(corpus));
+    std::istringstream          in(corpus);
+    for (const bool pack : {false, true}) {
+        {
+            jxxson::pmr::document_tree<>        tree(1024, &arena, &arena);
+            jxxson::pmr::document_tree_parser<> p{tree};
+            p.pack_arrays = pack;
+            counter.count = 0;
+            p(corpus, &arena, &arena);
+            tree["extra"]->value() = 1;
+            tree.find("accessors")[0]["more"];
+            tree.find("asset").emplace("copyright", jxxson::pmr::document_tree<>::node_value("a string longer than twelve", &arena));
+            jxxson::document_tree_edit<jxxson::pmr::document_tree<>> edit(tree);
+            edit.emplace(tree.find("scenes"), "", jxxson::pmr::document_tree<>::node_value("another long string value", &arena));
+            tree.apply(edit);
+            CHECK(counter.count == 0);
+            CHECK(minified(tree).size() > expected.size());
+        }
+        arena.reset();
+        {
+            jxxson::pmr::document_tree<> tree(1024, &arena, &arena);
+            in.clear(); in.seekg(0);
+            counter.count = 0;
+            jxxson::pmr::document_tree_parser<>{tree}(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>(), &arena, &arena);
+            CHECK(counter.count == 0);
+            CHECK(minified(tree) == expected);
+        }
+        arena.reset();
+    }
+    std::pmr::set_default_resource(previous);
+
+    // A value moved into a value of another resource is copied into that resource, with or without a type change.
+    using node_value = jxxson::pmr::document_tree<>::node_value;
+    counting_resource own, other;
+    node_value        target(1, &own), source("a string longer than twelve", &other), more("a string longer than the string before", &other);
+    target = std::move(source);
+    CHECK(own.count == 1 && target.as<std::string_view>() == "a string longer than twelve");
+    target = std::move(more);
+    CHECK(own.count == 2 && target.as<std::string_view>() == "a string longer than the string before");
+    CHECK(target.get_allocator().resource() == &own);
+    static_assert(std::is_nothrow_move_assignable_v<tree_type::node_value> && !std::is_nothrow_move_assignable_v<node_value>);
+}
+
+// Work split between threads gives what one thread gives, runs cover every descendant once at its depth.
+static void test_algorithms(const std::string& corpus) {
+    std::string json = "[";
+    for (std::size_t i = 0; i != 8; ++i) { json.append(i != 0 ? "," : "").append(corpus); }
+    tree_type        tree = parse(json + "]");
+    const tree_type& read = tree;
+    CHECK(tree.size() > 4 * 16384);
+
+    for (const std::size_t threads : {1, 4}) {
+        std::vector<std::size_t> depth(tree.size(), 0);
+        jxxson::for_each_level(tree, [&](std::size_t d, auto first, auto last) {
+            for (auto it = first; it != last; ++it) { depth[static_cast<std::size_t>(it - read.begin())] += d; }
+        }, threads);
+        bool levels = depth[0] == 0;
+        for (std::size_t i = 1; i != tree.size(); ++i) { levels = levels && depth[i] == depth[static_cast<std::size_t>(tree.data()[i].parent_index())] + 1; }
+        CHECK(levels);
+    }
+
+    const auto is_count = [](const auto& n) { return n.name() == "count"; };
+    const auto counts   = jxxson::count_if(tree, is_count);
+    CHECK(counts == 8 * static_cast<std::size_t>(jxxson::count_if(parse(corpus), is_count)) && jxxson::count_if(tree, is_count, 4) == counts);
+    CHECK(jxxson::count_if(tree, read.root().find(2), is_count, 4) == counts / 8);
+    // The first match in breadth first order, even if a later run finds one first.
+    const auto first = jxxson::find_if(tree, is_count, 4);
+    CHECK(first == jxxson::find_if(tree, is_count) && first == read.root().find(0).find("accessors").find(0).find("count"));
+    CHECK(jxxson::find_if(tree, read.root().find(7), is_count, 4) == read.root().find(7).find("accessors").find(0).find("count"));
+    CHECK(jxxson::find_if(tree, [](const auto& n) { return n.name() == "no such name"; }, 4) == read.end());
+
+    // Values change on every thread, names and shape do not, nodes outside the subtree are not visited.
+    tree_type serial = tree;
+    auto double_counts = [](auto& n) { if (n.name() == "count") { n.value() = tree_type::node_value(n.value().template as<int>() * 2); } };
+    jxxson::transform_values(tree, tree.root().find(1), double_counts, 4);
+    jxxson::transform_values(serial, serial.root().find(1), double_counts);
+    CHECK(minified(tree) == minified(serial) && minified(tree) != json + "]");
+    CHECK(tree.root().find(1).find("accessors").find(0).find("count")->value().as<int>() == 2 * tree.root().find(0).find("accessors").find(0).find("count")->value().as<int>());
+}
+
+// A snapshot reads back as the tree it was saved from, damaged files are rejected by the constructor or by verify().
+static void test_snapshot(const std::string& corpus) {
+    const auto      path = std::filesystem::temp_directory_path() / "jxxson_unit.snap";
+    const tree_type tree = parse(corpus);
+    jxxson::save_snapshot(tree, path);
+    {
+        const jxxson::document_tree_snapshot<> snap(path);
+        CHECK(snap.verify() && snap.size() == tree.size() && minified(snap) == minified(tree));
+        CHECK(snap.root().find("accessors").find(3).find("count")->value().as<int>() == tree.find("accessors").find(3).find("count")->value().as<int>());
+        const auto is_string = [](const auto& n) { return n.value().type == node_type::string; };
+        CHECK(jxxson::count_if(snap, is_string, 4) == jxxson::count_if(tree, is_string));
+    }
+    const std::string saved = read_file(path);
+    auto open_damaged = [&](std::size_t at, std::string_view bytes) {
+        std::string damaged = saved;
+        damaged.replace(at, bytes.size(), bytes);
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << damaged;
+        return jxxson::document_tree_snapshot<>(path);
+    };
+    CHECK(throws<std::runtime_error>([&] { open_damaged(0, "JSON"); }));                        // Magic.
+    CHECK(throws<std::runtime_error>([&] { open_damaged(20, std::string_view("\1", 1)); }));   // Flags.
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << saved.substr(0, saved.size() / 2);
+    CHECK(throws<std::runtime_error>([&] { jxxson::document_tree_snapshot<>{path}; }));          // Truncated.
+
+    // Records that point outside the file or at a later parent open, verify() finds them.
+    jxxson::detail::snapshot_header header{};
+    std::memcpy(&header, saved.data(), sizeof(header));
+    const auto          generator = tree.find("asset").find("generator") - tree.begin();
+    const std::size_t   record    = static_cast<std::size_t>(header.nodes_offset + static_cast<std::uint64_t>(generator) * header.node_size);
+    const std::int64_t  far       = std::int64_t{1} << 40;
+    const std::uint32_t long_size = std::numeric_limits<std::uint32_t>::max(), short_size = 1;
+    const std::int32_t  later     = 1 << 20;
+    auto bytes = [](const auto& v) { return std::string_view(reinterpret_cast<const char*>(&v), sizeof(v)); };
+    CHECK(!open_damaged(record, bytes(far)).verify());              // String.
+    CHECK(!open_damaged(record + 8, bytes(far)).verify());          // Name.
+    CHECK(!open_damaged(record + 20, bytes(long_size)).verify());   // String size.
+    CHECK(!open_damaged(record + 24, bytes(later)).verify());       // Parent.
+    CHECK(open_damaged(record + 20, bytes(short_size)).verify());
+
+    // A node count whose byte size overflows does not open, neither does a snapshot that can not be written.
+    const std::uint64_t huge_count = std::uint64_t{1} << 61;
+    CHECK(throws<std::runtime_error>([&] { open_damaged(24, bytes(huge_count)); }));
+    CHECK(throws<std::runtime_error>([&] { jxxson::save_snapshot(tree, path / "missing" / "x.snap"); }));
+    std::filesystem::remove(path);
+}
+
+// Readers keep the version they pinned, a version is freed once no reader can see it.
+static void test_publisher() {
+    using publisher_type = jxxson::document_tree_publisher<tree_type>;
+    publisher_type publisher(parse(R"({"a":0,"b":0})"));
+    {
+        const auto first = publisher.read();
+        CHECK(publisher.update([](tree_type& t) { t["a"]->value() = 1; t["b"]->value() = 1; }) == 1);
+        CHECK(first.version() == 0 && first->find("a")->value().as<int>() == 0 && minified(*first) == R"({"a":0,"b":0})");
+        CHECK(publisher.read()->find("a")->value().as<int>() == 1 && publisher.version() == 1);
+        CHECK(publisher.publish(parse(R"({"a":2,"b":2})")) == 2);
+        CHECK(publisher.reclaim() == 2);  // first still pins version 0, so 1 is kept as well.
+    }
+    CHECK(publisher.reclaim() == 0);
+
+    // Readers on several threads never see a and b differ while a writer keeps changing both.
+    std::atomic<bool> stop = false, torn = false;
+    std::vector<std::thread> readers;
+    for (std::size_t i = 0; i != 4; ++i) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                const auto version = publisher.read();
+                torn = torn || version->find("a")->value().as<int>() != version->find("b")->value().as<int>();
+            }
+        });
+    }
+    for (int n = 3; n != 300; ++n) { publisher.update([n](tree_type& t) { t["a"]->value() = n; t["b"]->value() = n; }); }
+    stop = true;
+    for (auto& t : readers) { t.join(); }
+    CHECK(!torn && publisher.version() == 299 && publisher.read()->find("b")->value().as<int>() == 299);
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+///                               Formatting                                    ///
+///////////////////////////////////////////////////////////////////////////////////
+
+static void test_format() {
+    const std::string json = R"({"a":[1,2.5,-3,0.1,1e+100],"b":{"c":"x\"y\\z","d":null,"e":true,"f":false},"g":[],"h":{}})";
+    const tree_type   tree = parse(json);
+    CHECK(minified(tree) == json);
+    CHECK(minified(parse(tree.to_string())) == json);
+    CHECK(minified(parse(tree.to_string({.pretty = true, .indent = 4}))) == json);
+    CHECK(tree.to_string() == "{\n  \"a\":[\n    1,\n    2.5,\n    -3,\n    0.1,\n    1e+100\n  ],\n"
+                              "  \"b\":{\n    \"c\":\"x\\\"y\\\\z\",\n    \"d\":null,\n    \"e\":true,\n    \"f\":false\n  },\n"
+                              "  \"g\":[\n  ],\n  \"h\":{\n  }\n}\n");
+    std::ostringstream os;
+    tree.format_to(os, jxxson::format_minified);
+    CHECK(os.str() == json);
+}
+
+// Splitting the work between threads does not change a byte of the output.
+static void test_format_parallel(const std::string& corpus) {
+    std::string json = "{\"documents\":[";
+    for (std::size_t i = 0; i != 6; ++i) { json.append(i != 0 ? "," : "").append(corpus); }
+    json += "],\"flat\":[";
+    for (std::size_t i = 0; i != 100000; ++i) { json.append(i != 0 ? "," : "").append(std::to_string(i)); }
+    json += "],\"deep\":" + std::string(300, '[') + "{}" + std::string(300, ']') + "}";
+    const tree_type tree = parse(json);
+    CHECK(tree.size() > 8 * 16384);
+    for (const jxxson::format_style& style : {jxxson::format_minified, jxxson::format_pretty, jxxson::format_style{.pretty = true, .indent = 3}}) {
+        const auto serial = tree.to_string(style);
+        for (const std::size_t threads : {2, 3, 4, 8}) { CHECK(tree.to_string(style, threads) == serial); }
+        std::ostringstream os;
+        tree.format_to(os, style, 4);
+        CHECK(os.str() == std::string(serial.begin(), serial.end()));
+    }
+    jxxson::document_tree_view<> view;
+    jxxson::document_tree_view_parser<>{view}(json);
+    CHECK(view.to_string(jxxson::format_pretty, 4) == std::string(tree.to_string()));
+}
+
+///////////////////////////////////////////////////////////////////////////////////
+///                              Struct Mapping                                 ///
+///////////////////////////////////////////////////////////////////////////////////
+
+static void test_schema() {
+    const std::string json = R"( {"id":-42,"nodes":[{"name":"a\"b","translation":[1,2.5,-3],"children":[1,2]},)"
+                             R"({"unknown":{"x":[1,{"y":"}"}]},"name":"c","visible":false}]} )";
+    unit_scene scene;
+    CHECK(jxxson::deserialize(json, scene) == json.end());
+    CHECK(scene.id == -42 && scene.nodes.size() == 2 && !scene.note);
+    CHECK(scene.nodes[0].name == "a\"b" && scene.nodes[0].translation == std::array<double, 3>{1, 2.5, -3});
+    CHECK(scene.nodes[0].children == std::vector<std::size_t>{1, 2} && scene.nodes[0].visible);
+    CHECK(scene.nodes[1].name == "c" && !scene.nodes[1].translation && !scene.nodes[1].visible);
+
+    // Empty optionals are left out, everything else reads back to the same value.
+    const std::string expected = R"({"nodes":[{"name":"a\"b","translation":[1.0,2.5,-3.0],"children":[1,2],"visible":true},)"
+                                 R"({"name":"c","children":[],"visible":false}],"id":-42})";
+    CHECK(jxxson::serialize(scene, jxxson::format_minified) == expected);
+    CHECK(jxxson::serialize(scene) == parse(expected).to_string());
+    unit_scene        again;
+    const std::string pretty = jxxson::serialize(scene);
+    CHECK(jxxson::deserialize(pretty, again) == pretty.end());
+    CHECK(jxxson::serialize(again, jxxson::format_minified) == expected);
+
+    // Set optionals, escaped keys and strings, and doubles that need every digit round trip too, through every writer.
+    unit_scene full;
+    const std::string escaped = R"({"note":"tab\t \u00e9 \"q\" \\ \u0001","nodes":[{"n\u0061me":"x","translation":[0.1,1e-300,-1.7976931348623157e308]}],"id":9007199254740993})";
+    CHECK(jxxson::deserialize(escaped, full) == escaped.end());
+    CHECK(full.note == "tab\t \xC3\xA9 \"q\" \\ \x01" && full.nodes.size() == 1 && full.nodes[0].name == "x" && full.id == 9007199254740993);
+    CHECK(full.nodes[0].translation == std::array<double, 3>{0.1, 1e-300, -1.7976931348623157e308});
+    const std::string written = jxxson::serialize(full, jxxson::format_minified);
+    CHECK(minified(parse(written)) == written);
+    unit_scene        round;
+    CHECK(jxxson::deserialize(written, round) == written.end());
+    CHECK(round.note == full.note && round.id == full.id && round.nodes[0].translation == full.nodes[0].translation);
+    std::ostringstream os;
+    jxxson::serialize_to(os, full);
+    std::string        out;
+    jxxson::serialize_to(std::back_inserter(out), full);
+    CHECK(os.str() == jxxson::serialize(full) && out == os.str());
+
+    // Every uint64 reads back, magnitudes beyond double do not.
+    std::vector<std::uint64_t> wide;
+    const std::string          uint64s = "[18446744073709551615,0]";
+    CHECK(jxxson::deserialize(uint64s, wide) == uint64s.end() && wide == std::vector<std::uint64_t>{18446744073709551615ull, 0});
+    const std::string          too_wide = "[18446744073709551616]";
+    CHECK(jxxson::deserialize(too_wide, wide) == too_wide.begin() + 1);
+    std::vector<double>        reals;
+    const std::string          huge = "[1.5,1e400]";
+    CHECK(jxxson::deserialize(huge, reals) == huge.begin() + 5);
+
+    // Reading stops at the first value that does not fit its member, numbers of unknown keys follow the number grammar.
+    const std::pair<std::string_view, std::ptrdiff_t> inputs[] = {{R"({"id":"x"})", 6}, {R"({"nodes":[{"translation":[1,2]}]})", 25},
+                                                                  {R"({"id":1.5})", 6}, {R"({"nodes":[{"visible":1}]})", 21}, {R"({"id":1)", 7},
+                                                                  {R"({"unknown":-.e+,"id":1})", 11}, {R"({"unknown":01,"id":1})", 11}};
+    for (const auto& [bad, stop] : inputs) {
+        unit_scene out;
+        CHECK(jxxson::deserialize(bad, out) - bad.begin() == stop);
+    }
+    unit_scene        skipped;
+    const std::string numbers = R"({"unknown":-0.5e-3,"big":1e400,"long":123456789012345678901234,"id":2})";
+    CHECK(jxxson::deserialize(numbers, skipped) == numbers.end() && skipped.id == 2);
+}
+
+int main() {
+    const std::string corpus = read_file("test.json");
+    CHECK(!corpus.empty());
+    test_relayout(corpus);
+    test_scanner();
+    test_unbalanced();
+    test_parse_parallel(corpus);
+    test_escapes();
+    test_numbers();
+    test_sax(corpus);
+    test_ndjson();
+    test_view(corpus);
+    test_child_and_key_index(corpus);
+    test_load_file(corpus);
+    test_edit();
+    test_erase(corpus);
+    test_query(corpus);
+    test_packed();
+    test_lazy(corpus);
+    test_arena(corpus);
+    test_algorithms(corpus);
+    test_snapshot(corpus);
+    test_publisher();
+    test_format();
+    test_format_parallel(corpus);
+    test_schema();
+    if (failures != 0) { std::cerr << failures << " checks failed\n"; return 1; }
+    std::cout << "all checks passed\n";
+    return 0;
+}